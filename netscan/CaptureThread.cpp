@@ -0,0 +1,146 @@
+//
+//  CaptureThread.cpp
+//  netscan
+//
+
+#include "CaptureThread.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <system_error>
+
+#include "MyLibC.hpp"
+#include "Trace.hpp"
+
+CaptureThread::CaptureThread(Pcap& pcap, std::size_t capacity, std::optional<int> cpu)
+  : pcap_{pcap}
+  , frames_(std::bit_ceil(std::max<std::size_t>(capacity, 1)))
+  , mask_{frames_.size() - 1}
+  , head_{0}, tail_{0}, armed_{false}, stop_{false}, lost_{0}, backlogged_{false}
+{
+#ifndef __linux__
+    if (cpu) {
+        throw std::system_error(ENOTSUP, std::generic_category(), "capture thread affinity");
+    }
+#endif
+
+    auto [r, w] = Pipe();
+    wake_read_ = r;
+    wake_write_ = w;
+    for (auto fd : {r, w}) {
+        FcntlSetFd(fd, FD_CLOEXEC | FcntlGetFd(fd));
+        fcntl(fd, F_SETFL, O_NONBLOCK | fcntl(fd, F_GETFL));
+    }
+
+    // Signals such as SIGCHLD must keep interrupting the consumer's wait,
+    // so the new thread starts with everything blocked.
+    sigset_t all;
+    sigfillset(&all);
+    auto const old = Sigprocmask(SIG_BLOCK, all);
+    try {
+        thread_ = std::thread([this] { run(); });
+    } catch (...) {
+        Sigprocmask(SIG_SETMASK, old);
+        Close(wake_read_);
+        Close(wake_write_);
+        throw;
+    }
+    Sigprocmask(SIG_SETMASK, old);
+
+#ifdef __linux__
+    if (cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(*cpu, &set);
+        if (auto e = pthread_setaffinity_np(thread_.native_handle(), sizeof set, &set)) {
+            stop();
+            throw std::system_error(e, std::generic_category(), "pthread_setaffinity_np");
+        }
+    }
+#endif
+}
+
+CaptureThread::~CaptureThread() {
+    stop();
+}
+
+auto CaptureThread::stop() -> void {
+    if (thread_.joinable()) {
+        stop_.store(true, std::memory_order_relaxed);
+        pcap_.breakloop();
+        thread_.join();
+        close(wake_read_);
+        close(wake_write_);
+    }
+}
+
+auto CaptureThread::arm() -> bool {
+    armed_.store(true);
+    if (head_.load() != tail_.load(std::memory_order_relaxed)) {
+        armed_.store(false, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+auto CaptureThread::run() -> void {
+    // A dispatch this large means replies are queueing faster than we drain them
+    static constexpr int backlog_threshold = 256;
+    static constexpr auto stats_interval = std::chrono::milliseconds{100};
+
+    std::uint64_t overflow = 0;
+    std::uint64_t dropped = 0;
+    auto next_stats = std::chrono::steady_clock::now();
+
+    auto copy = [this, &overflow](pcap_pkthdr const* header, u_char const* data) {
+        auto const head = head_.load(std::memory_order_relaxed);
+        NETSCAN_TRACE(reply_capture, header->caplen, head);
+        Profile::count(Profile::reply);
+        if (head - tail_.load(std::memory_order_acquire) > mask_) {
+            overflow++;
+            return;
+        }
+        auto& frame = frames_[head & mask_];
+        frame.header = *header;
+        frame.header.caplen = std::min<bpf_u_int32>(header->caplen, sizeof frame.data);
+        std::memcpy(frame.data, data, frame.header.caplen);
+        // Sequentially consistent so that arm() sees either the frame or
+        // the need for a wakeup
+        head_.store(head + 1);
+    };
+
+    try {
+        while (!stop_.load(std::memory_order_relaxed)) {
+            auto const n = pcap_.dispatch(0, copy);
+            if (n >= backlog_threshold) {
+                backlogged_.store(true, std::memory_order_relaxed);
+            }
+            if (0 < n && armed_.exchange(false)) {
+                char const byte = 0;
+                (void)write(wake_write_, &byte, 1);
+            }
+
+            auto const now = std::chrono::steady_clock::now();
+            if (next_stats <= now) {
+                auto const stats = pcap_.stats();
+                dropped = stats.ps_drop + stats.ps_ifdrop;
+                next_stats = now + stats_interval;
+            }
+            lost_.store(dropped + overflow, std::memory_order_relaxed);
+        }
+    } catch (std::exception const& e) {
+        // The consumer notices a dead capture through its scan finishing
+        // without replies; make the cause visible.
+        std::cerr << "Capture failed: " << e.what() << std::endl;
+    }
+}
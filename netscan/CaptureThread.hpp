@@ -0,0 +1,97 @@
+//
+//  CaptureThread.hpp
+//  netscan
+//
+
+#ifndef CaptureThread_hpp
+#define CaptureThread_hpp
+
+#include <unistd.h> // read
+#include <pcap/pcap.h>
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "Pcap.hpp"
+
+/// A captured frame truncated to the headers the scan looks at
+struct CapturedFrame {
+    pcap_pkthdr header; //!< caplen is clamped to the copied bytes
+    u_char data[128 - sizeof(pcap_pkthdr)];
+};
+
+/// Drains a capture on its own thread
+///
+/// The capture thread only copies frames into a lock-free single-producer,
+/// single-consumer queue, so a consumer stalled on output or process
+/// creation no longer leaves replies sitting in the kernel buffer. The
+/// consumer waits on fd() and drains the queue with dispatch().
+class CaptureThread final {
+    Pcap& pcap_;
+    std::vector<CapturedFrame> frames_;
+    std::size_t mask_;
+    int wake_read_;
+    int wake_write_;
+
+    alignas(64) std::atomic<std::size_t> head_; //!< frames ever queued
+    alignas(64) std::atomic<std::size_t> tail_; //!< frames ever consumed
+    alignas(64) std::atomic<bool> armed_;       //!< consumer is about to sleep
+    std::atomic<bool> stop_;
+    std::atomic<std::uint64_t> lost_;           //!< kernel drops and queue overflows
+    std::atomic<bool> backlogged_;
+
+    std::thread thread_;
+
+    auto run() -> void;
+    auto stop() -> void;
+
+public:
+    /// Start capturing
+    /// @param pcap capture owned by this thread until destruction
+    /// @param capacity minimum queue length, rounded up to a power of two
+    /// @param cpu processor to pin the capture thread to, if any (Linux)
+    /// @exception std::system\_error on failure to start or pin the thread
+    CaptureThread(Pcap& pcap, std::size_t capacity, std::optional<int> cpu = {});
+    ~CaptureThread();
+    CaptureThread(CaptureThread const&) = delete;
+    auto operator=(CaptureThread const&) -> CaptureThread& = delete;
+
+    /// @return descriptor that becomes readable after arm() when frames arrive
+    auto fd() const -> int { return wake_read_; }
+
+    /// Request a wakeup on fd() for the next queued frame
+    /// @return true when frames are already queued and there is no need to wait
+    auto arm() -> bool;
+
+    /// @return kernel drops plus frames lost to a full queue, since the start
+    auto lost() const -> std::uint64_t { return lost_.load(std::memory_order_relaxed); }
+
+    /// @return true when the capture fell behind since the last call
+    auto backlogged() -> bool { return backlogged_.exchange(false, std::memory_order_relaxed); }
+
+    /// Process every queued frame
+    /// @param callback invoked with each frame's header and data
+    /// @return number of frames processed
+    template <std::invocable<pcap_pkthdr const*, u_char const*> Callback>
+    auto dispatch(Callback& callback) -> std::size_t {
+        char buffer[64];
+        while (0 < read(wake_read_, buffer, sizeof buffer)) {}
+
+        auto const head = head_.load(std::memory_order_acquire);
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto const count = head - tail;
+        for (; tail != head; tail++) {
+            auto const& frame = frames_[tail & mask_];
+            callback(&frame.header, frame.data);
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+        return count;
+    }
+};
+
+#endif /* CaptureThread_hpp */
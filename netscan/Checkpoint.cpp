@@ -0,0 +1,96 @@
+//
+//  Checkpoint.cpp
+//  netscan
+//
+
+#include "Checkpoint.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "MappedFile.hpp"
+#include "MyLibC.hpp"
+
+namespace {
+
+constexpr char magic[8] {'N','S','C','K','P','T','\0','\0'};
+constexpr uint32_t version = 1;
+
+// File layout: header, outstanding[outstanding], macs[macs]
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t first;
+    uint32_t end;
+    uint32_t cursor;
+    uint32_t outstanding;
+    uint32_t reserved;
+    uint64_t macs;
+};
+
+} // namespace
+
+auto Checkpoint::save(char const* path) const -> void {
+    Header header {};
+    std::memcpy(header.magic, magic, sizeof magic);
+    header.version = version;
+    header.first = first;
+    header.end = end;
+    header.cursor = cursor;
+    header.outstanding = static_cast<uint32_t>(outstanding.size());
+    header.macs = macs.size();
+
+    // Write beside the target and rename so a crash never leaves a torn file
+    auto tmp = std::string(path) + ".tmp";
+    auto fd = Open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    try {
+        WriteAll(fd, reinterpret_cast<char const*>(&header), sizeof header);
+        WriteAll(fd, reinterpret_cast<char const*>(outstanding.data()), sizeof outstanding[0] * outstanding.size());
+        WriteAll(fd, reinterpret_cast<char const*>(macs.data()), sizeof macs[0] * macs.size());
+        Fsync(fd);
+    } catch (...) {
+        Close(fd);
+        throw;
+    }
+    Close(fd);
+    Rename(tmp.c_str(), path);
+}
+
+auto Checkpoint::load(char const* path) -> Checkpoint {
+    auto const file = MappedFile::open_readonly(path);
+    auto const invalid = std::runtime_error("malformed checkpoint");
+
+    Header header;
+    if (file.size() < sizeof header) {
+        throw invalid;
+    }
+    std::memcpy(&header, file.data(), sizeof header);
+    if (0 != std::memcmp(header.magic, magic, sizeof magic) || version != header.version) {
+        throw invalid;
+    }
+    if (file.size() != sizeof header + sizeof(uint32_t) * header.outstanding + sizeof(uint64_t) * header.macs) {
+        throw invalid;
+    }
+
+    Checkpoint c {header.first, header.end, header.cursor, {}, {}};
+    c.outstanding.resize(header.outstanding);
+    c.macs.resize(header.macs);
+
+    auto p = file.data() + sizeof header;
+    std::memcpy(c.outstanding.data(), p, sizeof c.outstanding[0] * c.outstanding.size());
+    p += sizeof c.outstanding[0] * c.outstanding.size();
+    std::memcpy(c.macs.data(), p, sizeof c.macs[0] * c.macs.size());
+    return c;
+}
+
+auto Checkpoint::discard(char const* path) -> void {
+    if (-1 == unlink(path) && ENOENT != errno) {
+        throw std::system_error(errno, std::generic_category(), "unlink");
+    }
+}
@@ -0,0 +1,38 @@
+//
+//  Checkpoint.hpp
+//  netscan
+//
+
+#ifndef Checkpoint_hpp
+#define Checkpoint_hpp
+
+#include <cstdint>
+#include <vector>
+
+/// Progress of an interrupted scan
+struct Checkpoint {
+    uint32_t first;    //!< first address of the range (host order)
+    uint32_t end;      //!< address after the last of the range (host order)
+    uint32_t cursor;   //!< next range address to probe (host order)
+    std::vector<uint32_t> outstanding; //!< addresses probed without a result yet
+    std::vector<uint64_t> macs;        //!< addresses already reported
+
+    /// Atomically replace a checkpoint file
+    /// @param path checkpoint file
+    /// @exception std::system\_error on failure to write
+    auto save(char const* path) const -> void;
+
+    /// Read a checkpoint file written by save
+    /// @param path checkpoint file
+    /// @exception std::system\_error on failure to read
+    /// @exception std::runtime\_error on malformed checkpoint
+    static auto load(char const* path) -> Checkpoint;
+
+    /// Remove the checkpoint of a finished scan so it cannot be resumed.
+    /// A missing file is not an error.
+    /// @param path checkpoint file
+    /// @exception std::system\_error on failure to remove
+    static auto discard(char const* path) -> void;
+};
+
+#endif /* Checkpoint_hpp */
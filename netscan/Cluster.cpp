@@ -0,0 +1,394 @@
+//
+//  Cluster.cpp
+//  netscan
+//
+
+#include "Cluster.hpp"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+#include "ExclusionSet.hpp"
+#include "MyLibC.hpp"
+
+namespace {
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: SO_NOSIGPIPE is set on the socket instead
+#endif
+
+auto configure(int fd) -> int {
+    FcntlSetFd(fd, FD_CLOEXEC | FcntlGetFd(fd));
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+    return fd;
+}
+
+/// Open a socket for an endpoint and apply op (bind or connect) to it
+template <class Op>
+auto with_endpoint(std::string const& endpoint, Op op, char const* what) -> int {
+    if (0 == endpoint.rfind("unix:", 0)) {
+        sockaddr_un sun {};
+        sun.sun_family = AF_UNIX;
+        auto path = endpoint.substr(5);
+        if (path.size() >= sizeof sun.sun_path) {
+            throw std::system_error(ENAMETOOLONG, std::generic_category(), what);
+        }
+        std::memcpy(sun.sun_path, path.c_str(), path.size() + 1);
+
+        auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (-1 == fd) {
+            throw std::system_error(errno, std::generic_category(), "socket");
+        }
+        if (-1 == op(fd, reinterpret_cast<sockaddr*>(&sun), socklen_t(sizeof sun))) {
+            auto e = errno;
+            Close(fd);
+            throw std::system_error(e, std::generic_category(), what);
+        }
+        return configure(fd);
+    }
+
+    auto colon = endpoint.rfind(':');
+    if (std::string::npos == colon) {
+        throw std::runtime_error("invalid endpoint: " + endpoint);
+    }
+    auto host = endpoint.substr(0, colon);
+    auto port = endpoint.substr(colon + 1);
+
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* res;
+    if (auto e = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res)) {
+        throw std::runtime_error(endpoint + ": " + gai_strerror(e));
+    }
+
+    auto e = 0;
+    for (auto ai = res; ai; ai = ai->ai_next) {
+        auto fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (-1 == fd) {
+            e = errno;
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        if (0 == op(fd, ai->ai_addr, ai->ai_addrlen)) {
+            freeaddrinfo(res);
+            return configure(fd);
+        }
+        e = errno;
+        Close(fd);
+    }
+    freeaddrinfo(res);
+    throw std::system_error(e, std::generic_category(), what);
+}
+
+template <class T>
+auto put(unsigned char*& p, T value) -> void {
+    for (auto i = sizeof value; i--; ) {
+        *p++ = static_cast<unsigned char>(value >> 8 * i);
+    }
+}
+
+template <class T>
+auto get(unsigned char const*& p) -> T {
+    T value = 0;
+    for (auto i = sizeof value; i--; ) {
+        value = static_cast<T>(value << 8 | *p++);
+    }
+    return value;
+}
+
+auto encode(ClusterFrame const& frame, unsigned char* p) -> void {
+    put(p, frame.type);
+    put(p, frame.first);
+    put(p, frame.end);
+    put(p, frame.reserved);
+    put(p, frame.record.timestamp_ns);
+    put(p, frame.record.mac);
+    put(p, frame.record.ipv4);
+    put(p, frame.record.rtt_us);
+    put(p, frame.record.flags);
+    put(p, frame.record.vlan);
+    put(p, frame.record.reserved);
+}
+
+auto decode(unsigned char const* p) -> ClusterFrame {
+    ClusterFrame frame;
+    frame.type = get<uint32_t>(p);
+    frame.first = get<uint32_t>(p);
+    frame.end = get<uint32_t>(p);
+    frame.reserved = get<uint32_t>(p);
+    frame.record.timestamp_ns = get<uint64_t>(p);
+    frame.record.mac = get<uint64_t>(p);
+    frame.record.ipv4 = get<uint32_t>(p);
+    frame.record.rtt_us = get<uint32_t>(p);
+    frame.record.flags = get<uint32_t>(p);
+    frame.record.vlan = get<uint16_t>(p);
+    frame.record.reserved = get<uint16_t>(p);
+    return frame;
+}
+
+} // namespace
+
+auto ListenEndpoint(std::string const& endpoint) -> int {
+    auto fd = with_endpoint(endpoint, [](int fd, sockaddr* sa, socklen_t len) {
+        return bind(fd, sa, len);
+    }, "bind");
+    if (-1 == listen(fd, 8)) {
+        auto e = errno;
+        Close(fd);
+        throw std::system_error(e, std::generic_category(), "listen");
+    }
+    return fd;
+}
+
+auto ConnectEndpoint(std::string const& endpoint) -> int {
+    return with_endpoint(endpoint, [](int fd, sockaddr* sa, socklen_t len) {
+        return connect(fd, sa, len);
+    }, "connect");
+}
+
+auto Accept(int fd) -> int {
+    for (;;) {
+        auto res = accept(fd, nullptr, nullptr);
+        if (-1 == res) {
+            auto e = errno;
+            if (EINTR != e) {
+                throw std::system_error(e, std::generic_category(), "accept");
+            }
+        } else {
+            return configure(res);
+        }
+    }
+}
+
+auto SendFrame(int fd, ClusterFrame const& frame) -> void {
+    unsigned char wire[ClusterFrame::wire_size];
+    encode(frame, wire);
+    std::size_t sent = 0;
+    while (sent < sizeof wire) {
+        auto res = send(fd, wire + sent, sizeof wire - sent, MSG_NOSIGNAL);
+        if (-1 == res) {
+            auto e = errno;
+            if (EINTR != e) {
+                throw std::system_error(e, std::generic_category(), "send");
+            }
+        } else {
+            sent += static_cast<std::size_t>(res);
+        }
+    }
+}
+
+auto RecvFrame(int fd) -> std::optional<ClusterFrame> {
+    unsigned char wire[ClusterFrame::wire_size];
+    auto got = ReadAll(fd, reinterpret_cast<char*>(wire), sizeof wire);
+    if (0 == got) {
+        return {};
+    }
+    if (sizeof wire != got) {
+        throw std::system_error(EPROTO, std::generic_category(), "truncated frame");
+    }
+    return decode(wire);
+}
+
+auto SendResult(int fd, ResultRecord const& record) -> void {
+    ClusterFrame frame {};
+    frame.type = ClusterFrame::result;
+    frame.record = record;
+    SendFrame(fd, frame);
+}
+
+auto ServeShards(int fd, std::function<void(Shard const&)> const& scan) -> void {
+    while (auto frame = RecvFrame(fd)) {
+        if (ClusterFrame::shard != frame->type) {
+            break;
+        }
+        scan({frame->first, frame->end});
+        frame->type = ClusterFrame::shard_done;
+        SendFrame(fd, *frame);
+    }
+}
+
+auto SplitTargets(std::vector<std::string> const& targets, int prefix, ExclusionSet const* exclude) -> std::vector<Shard> {
+    if (prefix < 0 || 32 < prefix) {
+        throw std::runtime_error("invalid shard prefix");
+    }
+    auto const size = uint64_t{1} << (32 - prefix);
+
+    std::vector<Shard> shards;
+    for (auto const& target : targets) {
+        // Parse through ExclusionSet to share its CIDR validation
+        ExclusionSet block;
+        block.add(target);
+        block.finalize();
+        uint64_t const first = uint64_t{block.first(0)} + 1;
+        uint64_t const end = block.last(0);
+
+        for (auto lo = first; lo < end; ) {
+            auto hi = std::min(end, (lo / size + 1) * size);
+            if (!exclude) {
+                shards.push_back({uint32_t(lo), uint32_t(hi)});
+                lo = hi;
+                continue;
+            }
+            // Emit the pieces between the excluded intervals in [lo, hi)
+            auto from = lo;
+            for (auto i = exclude->lower_bound(uint32_t(lo)); i < exclude->size() && exclude->first(i) < hi; i++) {
+                if (from < exclude->first(i)) {
+                    shards.push_back({uint32_t(from), exclude->first(i)});
+                }
+                from = std::max<uint64_t>(from, uint64_t{exclude->last(i)} + 1);
+            }
+            if (from < hi) {
+                shards.push_back({uint32_t(from), uint32_t(hi)});
+            }
+            lo = hi;
+        }
+    }
+    return shards;
+}
+
+Coordinator::Coordinator(std::vector<std::string> const& endpoints) {
+    try {
+        for (auto const& endpoint : endpoints) {
+            workers_.push_back({endpoint, ConnectEndpoint(endpoint), {}});
+        }
+    } catch (...) {
+        for (auto const& w : workers_) {
+            Close(w.fd);
+        }
+        throw;
+    }
+}
+
+Coordinator::~Coordinator() {
+    for (auto const& w : workers_) {
+        Close(w.fd);
+    }
+}
+
+auto Coordinator::run(std::vector<Shard> shards, std::function<void(ResultRecord const&)> const& result) -> void {
+    std::deque<Shard> queue(shards.begin(), shards.end());
+
+    auto drop = [&](Worker& w) {
+        std::cerr << "worker " << w.endpoint << " lost" << std::endl;
+        if (w.shard) {
+            queue.push_back(*w.shard);
+            w.shard.reset();
+        }
+        Close(w.fd);
+        w.fd = -1;
+    };
+
+    // Idle workers stay connected until every shard is done, so that work
+    // from a lost worker can still be reassigned.
+    auto assign = [&] {
+        for (auto& w : workers_) {
+            if (-1 == w.fd || w.shard || queue.empty()) {
+                continue;
+            }
+            w.shard = queue.front();
+            queue.pop_front();
+            ClusterFrame frame {};
+            frame.type = ClusterFrame::shard;
+            frame.first = w.shard->first;
+            frame.end = w.shard->end;
+            try {
+                SendFrame(w.fd, frame);
+            } catch (std::system_error const&) {
+                drop(w);
+            }
+        }
+        workers_.erase(std::remove_if(workers_.begin(), workers_.end(), [](auto const& w) {
+            return -1 == w.fd;
+        }), workers_.end());
+    };
+
+    using clock = std::chrono::steady_clock;
+    std::vector<clock::time_point> due;
+    for (auto const& p : periodic_) {
+        due.push_back(clock::now() + p.interval);
+    }
+
+    std::vector<pollfd> fds;
+    for (;;) {
+        // Losing a worker during assignment can free up more work
+        auto before = workers_.size() + 1;
+        while (!queue.empty() && before != workers_.size()) {
+            before = workers_.size();
+            assign();
+        }
+
+        auto busy = std::any_of(workers_.begin(), workers_.end(), [](auto const& w) { return w.shard.has_value(); });
+        if (!busy) {
+            if (!queue.empty()) {
+                throw std::runtime_error("all workers lost with shards remaining");
+            }
+            ClusterFrame frame {};
+            frame.type = ClusterFrame::finish;
+            for (auto const& w : workers_) {
+                try {
+                    SendFrame(w.fd, frame);
+                } catch (std::system_error const&) {}
+            }
+            return;
+        }
+
+        fds.clear();
+        for (auto const& w : workers_) {
+            fds.push_back({w.fd, POLLIN, 0});
+        }
+        std::optional<std::chrono::milliseconds> timeout;
+        auto const now = clock::now();
+        for (std::size_t i = 0; i < periodic_.size(); i++) {
+            if (due[i] <= now) {
+                periodic_[i].task();
+                due[i] = now + periodic_[i].interval;
+            }
+            auto const left = std::chrono::ceil<std::chrono::milliseconds>(due[i] - now);
+            timeout = timeout ? std::min(*timeout, left) : left;
+        }
+        if (0 >= Poll(fds.data(), fds.size(), timeout)) {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < fds.size(); i++) {
+            if (0 == fds[i].revents) {
+                continue;
+            }
+            auto& w = workers_[i];
+            try {
+                auto frame = RecvFrame(w.fd);
+                if (!frame) {
+                    drop(w);
+                } else if (ClusterFrame::result == frame->type) {
+                    result(frame->record);
+                } else if (ClusterFrame::shard_done == frame->type) {
+                    w.shard.reset();
+                }
+            } catch (std::system_error const&) {
+                drop(w);
+            }
+        }
+
+        workers_.erase(std::remove_if(workers_.begin(), workers_.end(), [](auto const& w) {
+            return -1 == w.fd;
+        }), workers_.end());
+    }
+}
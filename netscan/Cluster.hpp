@@ -0,0 +1,135 @@
+//
+//  Cluster.hpp
+//  netscan
+//
+
+#ifndef Cluster_hpp
+#define Cluster_hpp
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ResultRing.hpp" // ResultRecord
+
+class ExclusionSet;
+
+/// A contiguous block of addresses assigned to one worker
+struct Shard {
+    uint32_t first; //!< host order
+    uint32_t end;   //!< address after the last (host order)
+};
+
+/// Fixed-size message exchanged between coordinator and workers
+///
+/// The coordinator sends `shard` frames, one at a time per worker, and
+/// `finish` when no work remains. A worker streams a `result` frame for
+/// each host it finds and a `shard_done` frame when a shard is complete.
+///
+/// On the wire a frame is 48 bytes: every field in declaration order,
+/// big-endian, so that workers may run on hosts of either byte order.
+struct ClusterFrame {
+    static constexpr std::size_t wire_size = 48;
+
+    enum Type : uint32_t {
+        shard = 1,
+        finish = 2,
+        result = 3,
+        shard_done = 4,
+    };
+
+    uint32_t type;
+    uint32_t first;
+    uint32_t end;
+    uint32_t reserved;
+    ResultRecord record;
+};
+
+/// Bind and listen on an endpoint of the form `unix:PATH` or `HOST:PORT`
+/// @exception std::system\_error on failure
+auto ListenEndpoint(std::string const& endpoint) -> int;
+
+/// Connect to an endpoint of the form `unix:PATH` or `HOST:PORT`
+/// @exception std::system\_error on failure
+auto ConnectEndpoint(std::string const& endpoint) -> int;
+
+/// Accept a connection on a listening socket
+/// @exception std::system\_error on failure
+auto Accept(int fd) -> int;
+
+/// Write a whole frame
+/// @exception std::system\_error on failure, including a closed peer
+auto SendFrame(int fd, ClusterFrame const& frame) -> void;
+
+/// Read a whole frame
+/// @return frame or empty when the peer closed the connection
+/// @exception std::system\_error on failure
+auto RecvFrame(int fd) -> std::optional<ClusterFrame>;
+
+/// Stream a found host to the coordinator
+/// @exception std::system\_error on failure, including a closed peer
+auto SendResult(int fd, ResultRecord const& record) -> void;
+
+/// Worker side of the protocol: scan each shard the coordinator hands out
+/// and acknowledge it, until told to finish or disconnected
+/// @param fd connection to the coordinator
+/// @param scan probes every address of a shard, sending each new host
+/// with SendResult before it returns
+/// @exception std::system\_error on failure
+auto ServeShards(int fd, std::function<void(Shard const&)> const& scan) -> void;
+
+/// Split the interior of CIDR blocks into aligned shards
+/// @param targets CIDR blocks such as "10.0.0.0/16"
+/// @param prefix prefix length of each shard
+/// @param exclude finalized set of addresses to leave out of the shards, if any
+/// @return shards covering every address except each block's network and
+/// broadcast addresses and the excluded ones; shards are split around
+/// excluded ranges and dropped when nothing is left of them
+/// @exception std::runtime\_error on malformed target
+auto SplitTargets(std::vector<std::string> const& targets, int prefix, ExclusionSet const* exclude = nullptr) -> std::vector<Shard>;
+
+/// Hands shards to connected workers and merges their results
+///
+/// Workers pull a new shard as soon as they finish the last one. A shard
+/// held by a worker that disconnects is given to another worker.
+class Coordinator final {
+    struct Worker {
+        std::string endpoint;
+        int fd;
+        std::optional<Shard> shard;
+    };
+    struct Periodic {
+        std::chrono::milliseconds interval;
+        std::function<void()> task;
+    };
+    std::vector<Worker> workers_;
+    std::vector<Periodic> periodic_;
+
+public:
+    /// Connect to every worker
+    /// @param endpoints worker endpoints
+    /// @exception std::system\_error on failure to connect
+    explicit Coordinator(std::vector<std::string> const& endpoints);
+    ~Coordinator();
+    Coordinator(Coordinator const&) = delete;
+    auto operator=(Coordinator const&) -> Coordinator& = delete;
+
+    /// Run a task at a fixed interval while shards are being scanned
+    /// @param interval time between runs
+    /// @param task work to perform
+    auto every(std::chrono::milliseconds interval, std::function<void()> task) -> void {
+        periodic_.push_back({interval, std::move(task)});
+    }
+
+    /// Scan all shards
+    /// @param shards work to distribute
+    /// @param result invoked with each result frame's record
+    /// @exception std::runtime\_error when all workers are lost with work remaining
+    auto run(std::vector<Shard> shards, std::function<void(ResultRecord const&)> const& result) -> void;
+};
+
+#endif /* Cluster_hpp */
@@ -0,0 +1,103 @@
+//
+//  ExclusionSet.cpp
+//  netscan
+//
+
+#include "ExclusionSet.hpp"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "MyLibC.hpp"
+
+auto ExclusionSet::add(uint32_t first, uint32_t last) -> void {
+    firsts_.push_back(first);
+    lasts_.push_back(last);
+    sorted_ = false;
+}
+
+auto ExclusionSet::add(std::string_view cidr) -> void {
+    auto const invalid = std::runtime_error("invalid exclusion: " + std::string(cidr));
+
+    auto slash = cidr.find('/');
+    auto addr = InAddrPton(std::string(cidr.substr(0, slash)).c_str());
+    if (!addr) {
+        throw invalid;
+    }
+
+    int prefix = 32;
+    if (std::string_view::npos != slash) {
+        auto digits = cidr.substr(slash + 1);
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), prefix);
+        if (std::errc{} != ec || ptr != digits.data() + digits.size() || prefix < 0 || 32 < prefix) {
+            throw invalid;
+        }
+    }
+
+    auto const host = uint32_t((uint64_t{1} << (32 - prefix)) - 1);
+    auto const first = ntohl(*addr) & ~host;
+    add(first, first | host);
+}
+
+auto ExclusionSet::load(char const* path) -> void {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error(std::string("unable to open ") + path);
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string_view text = line;
+        text = text.substr(0, text.find('#'));
+        auto const ws = " \t\r";
+        auto begin = text.find_first_not_of(ws);
+        if (std::string_view::npos == begin) {
+            continue;
+        }
+        text = text.substr(begin, text.find_last_not_of(ws) - begin + 1);
+        add(text);
+    }
+}
+
+auto ExclusionSet::finalize() -> void {
+    if (sorted_) {
+        return;
+    }
+
+    std::vector<std::size_t> order(firsts_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](auto x, auto y) { return firsts_[x] < firsts_[y]; });
+
+    std::vector<uint32_t> firsts, lasts;
+    for (auto i : order) {
+        // Merge overlapping and adjacent intervals
+        if (!lasts.empty() && uint64_t{firsts_[i]} <= uint64_t{lasts.back()} + 1) {
+            lasts.back() = std::max(lasts.back(), lasts_[i]);
+        } else {
+            firsts.push_back(firsts_[i]);
+            lasts.push_back(lasts_[i]);
+        }
+    }
+
+    firsts_ = std::move(firsts);
+    lasts_ = std::move(lasts);
+    sorted_ = true;
+}
+
+auto ExclusionSet::lower_bound(uint32_t addr) const -> std::size_t {
+    return static_cast<std::size_t>(std::lower_bound(lasts_.begin(), lasts_.end(), addr) - lasts_.begin());
+}
+
+auto ExclusionSet::contains(uint32_t addr) const -> bool {
+    auto it = std::upper_bound(firsts_.begin(), firsts_.end(), addr);
+    if (it == firsts_.begin()) {
+        return false;
+    }
+    return addr <= lasts_[static_cast<std::size_t>(it - firsts_.begin()) - 1];
+}
@@ -0,0 +1,57 @@
+//
+//  ExclusionSet.hpp
+//  netscan
+//
+
+#ifndef ExclusionSet_hpp
+#define ExclusionSet_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/// Set of IPv4 addresses that must never be probed
+///
+/// Stored as sorted, merged, disjoint intervals with the first and last
+/// addresses in separate arrays, so a membership test is a binary search
+/// over a few cache lines of interval starts.
+class ExclusionSet final {
+    std::vector<uint32_t> firsts_;
+    std::vector<uint32_t> lasts_;
+    bool sorted_;
+
+public:
+    ExclusionSet() : sorted_{true} {}
+
+    /// Exclude an inclusive range of addresses (host order)
+    auto add(uint32_t first, uint32_t last) -> void;
+
+    /// Exclude an address or CIDR block such as "10.1.0.0/16"
+    /// @exception std::runtime\_error on malformed text
+    auto add(std::string_view cidr) -> void;
+
+    /// Exclude each address or CIDR block listed in a file, one per line.
+    /// Blank lines and text following '#' are ignored.
+    /// @exception std::runtime\_error on unreadable file or malformed line
+    auto load(char const* path) -> void;
+
+    /// Sort and merge the intervals; required after adding and before use
+    auto finalize() -> void;
+
+    auto empty() const -> bool { return firsts_.empty(); }
+
+    /// @return number of disjoint excluded intervals
+    auto size() const -> std::size_t { return firsts_.size(); }
+
+    /// @return index of the first interval that does not end before addr
+    auto lower_bound(uint32_t addr) const -> std::size_t;
+
+    auto first(std::size_t i) const -> uint32_t { return firsts_[i]; }
+    auto last(std::size_t i) const -> uint32_t { return lasts_[i]; }
+
+    /// @return true when addr is excluded
+    auto contains(uint32_t addr) const -> bool;
+};
+
+#endif /* ExclusionSet_hpp */
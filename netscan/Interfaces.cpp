@@ -0,0 +1,107 @@
+//
+//  Interfaces.cpp
+//  netscan
+//
+
+#include "Interfaces.hpp"
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <netpacket/packet.h>
+#else
+#include <net/if_dl.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <system_error>
+
+namespace {
+
+/// @return Ethernet address carried by a link-layer socket address, if any
+auto link_address(sockaddr const* sa) -> uint64_t {
+    unsigned char const* bytes = nullptr;
+#ifdef __linux__
+    if (AF_PACKET == sa->sa_family) {
+        auto ll = reinterpret_cast<sockaddr_ll const*>(sa);
+        if (6 == ll->sll_halen) {
+            bytes = ll->sll_addr;
+        }
+    }
+#else
+    if (AF_LINK == sa->sa_family) {
+        auto dl = reinterpret_cast<sockaddr_dl const*>(sa);
+        if (6 == dl->sdl_alen) {
+            bytes = reinterpret_cast<unsigned char const*>(LLADDR(dl));
+        }
+    }
+#endif
+    uint64_t mac = 0;
+    if (bytes) {
+        for (auto i = 0; i < 6; i++) {
+            mac = mac << 8 | bytes[i];
+        }
+    }
+    return mac;
+}
+
+using IfaddrsPtr = std::unique_ptr<ifaddrs, decltype(&freeifaddrs)>;
+
+auto get_ifaddrs() -> IfaddrsPtr {
+    ifaddrs* list;
+    if (-1 == getifaddrs(&list)) {
+        throw std::system_error(errno, std::generic_category(), "getifaddrs");
+    }
+    return {list, freeifaddrs};
+}
+
+} // namespace
+
+auto InterfaceMac(std::string const& device) -> uint64_t {
+    auto const list = get_ifaddrs();
+    for (auto i = list.get(); i; i = i->ifa_next) {
+        if (i->ifa_addr && device == i->ifa_name) {
+            if (auto mac = link_address(i->ifa_addr)) {
+                return mac;
+            }
+        }
+    }
+    return 0;
+}
+
+auto InterfaceAddresses() -> std::vector<InterfaceAddress> {
+    auto const guard = get_ifaddrs();
+    auto const list = guard.get();
+
+    // Link addresses are listed as separate entries of the same interface
+    std::map<std::string, uint64_t> macs;
+    for (auto i = list; i; i = i->ifa_next) {
+        if (i->ifa_addr) {
+            if (auto mac = link_address(i->ifa_addr)) {
+                macs[i->ifa_name] = mac;
+            }
+        }
+    }
+
+    std::vector<InterfaceAddress> result;
+    for (auto i = list; i; i = i->ifa_next) {
+        if (!i->ifa_addr || AF_INET != i->ifa_addr->sa_family || !i->ifa_netmask) {
+            continue;
+        }
+        InterfaceAddress entry;
+        entry.device = i->ifa_name;
+        entry.flags = i->ifa_flags;
+        entry.mac = macs[entry.device];
+        entry.ipv4 = ntohl(reinterpret_cast<sockaddr_in const*>(i->ifa_addr)->sin_addr.s_addr);
+        entry.netmask = ntohl(reinterpret_cast<sockaddr_in const*>(i->ifa_netmask)->sin_addr.s_addr);
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
@@ -0,0 +1,32 @@
+//
+//  Interfaces.hpp
+//  netscan
+//
+
+#ifndef Interfaces_hpp
+#define Interfaces_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// An IPv4 address assigned to a network interface
+struct InterfaceAddress {
+    std::string device;
+    unsigned flags;   //!< IFF\_ flags of the interface
+    uint64_t mac;     //!< 48-bit link address, right-aligned, or 0 when it has none
+    uint32_t ipv4;    //!< host order
+    uint32_t netmask; //!< host order
+};
+
+/// List the IPv4 addresses of every interface, with each interface's
+/// Ethernet address
+/// @exception std::system\_error on failure
+auto InterfaceAddresses() -> std::vector<InterfaceAddress>;
+
+/// @param device interface name
+/// @return Ethernet address of an interface or 0 when it has none
+/// @exception std::system\_error on failure
+auto InterfaceMac(std::string const& device) -> uint64_t;
+
+#endif /* Interfaces_hpp */
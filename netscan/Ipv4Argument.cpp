@@ -0,0 +1,21 @@
+//
+//  Ipv4Argument.cpp
+//  netscan
+//
+
+#include "Ipv4Argument.hpp"
+
+#include <boost/program_options.hpp>
+
+#include "MyLibC.hpp"
+
+auto validate(boost::any& v, std::vector<std::string> const& values, ipv4_argument*, int) -> void {
+    namespace po = boost::program_options;
+    po::validators::check_first_occurrence(v);
+    auto const& s = po::validators::get_single_string(values);
+    if (auto a = InAddrPton(s.c_str())) {
+        v = boost::any(ipv4_argument{*a});
+    } else {
+        throw po::validation_error(po::validation_error::invalid_option_value);
+    }
+}
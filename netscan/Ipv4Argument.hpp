@@ -0,0 +1,24 @@
+//
+//  Ipv4Argument.hpp
+//  netscan
+//
+
+#ifndef Ipv4Argument_hpp
+#define Ipv4Argument_hpp
+
+#include <arpa/inet.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/any.hpp>
+
+/// Dotted-quad command line argument (network byte order)
+struct ipv4_argument {
+    in_addr_t value;
+};
+
+// Used by boost::program_options internally
+auto validate(boost::any& v, std::vector<std::string> const& values, ipv4_argument*, int) -> void;
+
+#endif /* Ipv4Argument_hpp */
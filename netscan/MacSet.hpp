@@ -0,0 +1,164 @@
+//
+//  MacSet.hpp
+//  netscan
+//
+
+#ifndef MacSet_hpp
+#define MacSet_hpp
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Open-addressed set of 48-bit MAC addresses
+///
+/// Membership tests touch a single cache line in the common case, which
+/// keeps the per-packet cost of deduplication flat on busy segments.
+class MacSet final {
+    // Stored keys carry a tag bit so that zero can mark empty slots
+    static constexpr std::uint64_t tag = std::uint64_t{1} << 63;
+
+    std::vector<std::uint64_t> slots_;
+    std::size_t size_;
+
+    static auto hash(std::uint64_t key) -> std::uint64_t {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    auto grow() -> void {
+        std::vector<std::uint64_t> old(slots_.size() * 2);
+        old.swap(slots_);
+        for (auto key : old) {
+            if (key) {
+                place(key);
+            }
+        }
+    }
+
+    auto place(std::uint64_t key) -> bool {
+        auto const mask = slots_.size() - 1;
+        for (auto i = hash(key) & mask;; i = (i + 1) & mask) {
+            auto& slot = slots_[i];
+            if (slot == key) {
+                return false;
+            }
+            if (0 == slot) {
+                slot = key;
+                return true;
+            }
+        }
+    }
+
+public:
+    explicit MacSet(std::size_t capacity = 1024) : slots_(std::size_t{1} << std::bit_width(capacity | 1)), size_{0} {}
+
+    /// Add an address to the set
+    /// @param mac 48-bit address, right-aligned
+    /// @return true when the address was not already present
+    auto insert(std::uint64_t mac) -> bool {
+        if (!place(mac | tag)) {
+            return false;
+        }
+        // Keep the load factor at or below one half
+        if (++size_ * 2 > slots_.size()) {
+            grow();
+        }
+        return true;
+    }
+
+    auto contains(std::uint64_t mac) const -> bool {
+        auto const key = mac | tag;
+        auto const mask = slots_.size() - 1;
+        for (auto i = hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots_[i] == key) {
+                return true;
+            }
+            if (0 == slots_[i]) {
+                return false;
+            }
+        }
+    }
+
+    auto size() const -> std::size_t { return size_; }
+
+    /// Visit every address in the set in unspecified order
+    template <std::invocable<std::uint64_t> Callback>
+    auto for_each(Callback&& callback) const -> void {
+        for (auto key : slots_) {
+            if (key) {
+                callback(key & ~tag);
+            }
+        }
+    }
+};
+
+/// Open-addressed set of MAC and IPv4 address pairs
+///
+/// The same layout as MacSet with the IPv4 address stored beside each
+/// key, so pairs are compared exactly.
+class AddressPairSet final {
+    static constexpr std::uint64_t tag = std::uint64_t{1} << 63;
+
+    struct Slot {
+        std::uint64_t key; //!< tagged MacSet key, 0 when empty
+        std::uint32_t ipv4;
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t size_;
+
+    static auto hash(std::uint64_t key, std::uint32_t ipv4) -> std::uint64_t {
+        key ^= std::uint64_t{ipv4} * 0x9e3779b97f4a7c15ULL;
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    auto place(Slot slot) -> bool {
+        auto const mask = slots_.size() - 1;
+        for (auto i = hash(slot.key, slot.ipv4) & mask;; i = (i + 1) & mask) {
+            auto& s = slots_[i];
+            if (s.key == slot.key && s.ipv4 == slot.ipv4) {
+                return false;
+            }
+            if (0 == s.key) {
+                s = slot;
+                return true;
+            }
+        }
+    }
+
+public:
+    explicit AddressPairSet(std::size_t capacity = 1024) : slots_(std::size_t{1} << std::bit_width(capacity | 1)), size_{0} {}
+
+    /// Add a pair to the set
+    /// @param key MacSet key: 48-bit address, right-aligned, with a VLAN ID above
+    /// @param ipv4 address (host order)
+    /// @return true when the pair was not already present
+    auto insert(std::uint64_t key, std::uint32_t ipv4) -> bool {
+        if (!place({key | tag, ipv4})) {
+            return false;
+        }
+        // Keep the load factor at or below one half
+        if (++size_ * 2 > slots_.size()) {
+            std::vector<Slot> old(slots_.size() * 2);
+            old.swap(slots_);
+            for (auto const& s : old) {
+                if (s.key) {
+                    place(s);
+                }
+            }
+        }
+        return true;
+    }
+
+    auto size() const -> std::size_t { return size_; }
+};
+
+#endif /* MacSet_hpp */
@@ -0,0 +1,75 @@
+//
+//  MappedFile.cpp
+//  netscan
+//
+
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+#include "MyLibC.hpp"
+
+auto MappedFile::Unmap::operator()(std::byte* p) const noexcept -> void {
+    munmap(p, size);
+}
+
+MappedFile::MappedFile(std::byte* data, std::size_t size) noexcept : data_{data, Unmap{size}} {}
+
+auto MappedFile::open_readonly(char const* path) -> MappedFile {
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (-1 == fd) {
+        throw std::system_error(errno, std::generic_category(), "open");
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st)) {
+        auto e = errno;
+        Close(fd);
+        throw std::system_error(e, std::generic_category(), "fstat");
+    }
+
+    auto size = static_cast<std::size_t>(st.st_size);
+    auto p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    auto e = errno;
+    Close(fd);
+    if (MAP_FAILED == p) {
+        throw std::system_error(e, std::generic_category(), "mmap");
+    }
+    return MappedFile{static_cast<std::byte*>(p), size};
+}
+
+auto MappedFile::create(char const* path, std::size_t size) -> MappedFile {
+    auto fd = Open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (-1 == ftruncate(fd, static_cast<off_t>(size))) {
+        auto e = errno;
+        Close(fd);
+        throw std::system_error(e, std::generic_category(), "ftruncate");
+    }
+
+    auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto e = errno;
+    Close(fd);
+    if (MAP_FAILED == p) {
+        throw std::system_error(e, std::generic_category(), "mmap");
+    }
+    return MappedFile{static_cast<std::byte*>(p), size};
+}
+
+auto MappedFile::data() -> std::byte* {
+    return data_.get();
+}
+
+auto MappedFile::data() const -> std::byte const* {
+    return data_.get();
+}
+
+auto MappedFile::size() const -> std::size_t {
+    return data_.get_deleter().size;
+}
@@ -0,0 +1,42 @@
+//
+//  MappedFile.hpp
+//  netscan
+//
+
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <cstddef>
+#include <memory>
+
+/// Wrapper for a memory-mapped file
+class MappedFile final {
+    struct Unmap {
+        std::size_t size;
+        auto operator()(std::byte* p) const noexcept -> void;
+    };
+    std::unique_ptr<std::byte, Unmap> data_;
+
+    MappedFile(std::byte* data, std::size_t size) noexcept;
+
+public:
+    /// Map an entire file for reading
+    /// @param path file to map
+    /// @return read-only mapping
+    /// @exception std::system\_error on failure to open or map
+    static auto open_readonly(char const* path) -> MappedFile;
+
+    /// Create or truncate a file and map it for reading and writing. The
+    /// mapping is shared with other processes mapping the same file.
+    /// @param path file to create
+    /// @param size file size in bytes, initially zero filled
+    /// @return read-write mapping
+    /// @exception std::system\_error on failure to create or map
+    static auto create(char const* path, std::size_t size) -> MappedFile;
+
+    auto data() -> std::byte*;
+    auto data() const -> std::byte const*;
+    auto size() const -> std::size_t;
+};
+
+#endif /* MappedFile_hpp */
@@ -11,6 +11,7 @@
 #include <fcntl.h>
 
 #include <cerrno>
+#include <cstdio>
 #include <stdexcept>
 #include <system_error>
 
@@ -113,6 +114,47 @@ auto Close(int fd) -> void {
     }
 }
 
+/// Open a file
+/// @param path file to open
+/// @param flags access mode and creation flags
+/// @param mode permissions for newly created files
+/// @return file descriptor
+/// @exception std::system\_error
+auto Open(char const* path, int flags, mode_t mode) -> int {
+    for (;;) {
+        auto res = open(path, flags, mode);
+        if (-1 == res) {
+            auto e = errno;
+            if (EINTR != e) {
+                throw std::system_error(e, std::generic_category(), "open");
+            }
+        } else {
+            return res;
+        }
+    }
+}
+
+/// Flush a file to stable storage
+/// @param fd file descriptor
+/// @exception std::system\_error
+auto Fsync(int fd) -> void {
+    auto res = fsync(fd);
+    if (-1 == res) {
+        throw std::system_error(errno, std::generic_category(), "fsync");
+    }
+}
+
+/// Atomically rename a file, replacing any existing target
+/// @param from current name
+/// @param to new name
+/// @exception std::system\_error
+auto Rename(char const* from, char const* to) -> void {
+    auto res = rename(from, to);
+    if (-1 == res) {
+        throw std::system_error(errno, std::generic_category(), "rename");
+    }
+}
+
 /// Write as many bytes as possible to file descriptor until complete or
 /// file is closed.
 /// @param fd file descriptor
@@ -34,6 +34,9 @@ auto InAddrPton(char const* str) -> std::optional<in_addr_t>;
 auto Sigaction(int sig, struct sigaction const& act) -> struct sigaction;
 auto Sigprocmask(int how, sigset_t const& set) -> sigset_t;
 auto Close(int fd) -> void;
+auto Open(char const* path, int flags, mode_t mode = 0) -> int;
+auto Fsync(int fd) -> void;
+auto Rename(char const* from, char const* to) -> void;
 auto WriteAll(int fd, char const* buf, size_t n) -> size_t;
 auto ReadAll(int fd, char* buf, size_t n) -> size_t;
 struct Pipes {
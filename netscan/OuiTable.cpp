@@ -0,0 +1,200 @@
+//
+//  OuiTable.cpp
+//  netscan
+//
+
+#include "OuiTable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+constexpr char magic[8] {'N','S','O','U','I','\0','\0','\0'};
+constexpr std::uint32_t version = 1;
+constexpr std::uint32_t unassigned = UINT32_MAX;
+constexpr std::size_t index_size = (std::size_t{1} << 16) + 1;
+
+// File layout: header, starts[count], index[index_size], names[count], strings
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint64_t strings;
+    std::uint64_t reserved;
+};
+
+struct Interval {
+    std::uint64_t start;
+    std::uint32_t name;
+};
+
+} // namespace
+
+OuiTable::OuiTable(MappedFile file) : file_{std::move(file)}
+{
+    auto const invalid = std::runtime_error("malformed OUI table");
+
+    Header header;
+    if (file_.size() < sizeof header) {
+        throw invalid;
+    }
+    std::memcpy(&header, file_.data(), sizeof header);
+    if (0 != std::memcmp(header.magic, magic, sizeof magic) || version != header.version) {
+        throw invalid;
+    }
+
+    count_ = header.count;
+    strings_size_ = header.strings;
+    auto const expected = sizeof header
+                        + sizeof *starts_ * count_
+                        + sizeof *index_ * index_size
+                        + sizeof *names_ * count_
+                        + strings_size_;
+    if (expected != file_.size()) {
+        throw invalid;
+    }
+
+    auto p = file_.data() + sizeof header;
+    starts_ = reinterpret_cast<std::uint64_t const*>(p);
+    p += sizeof *starts_ * count_;
+    index_ = reinterpret_cast<std::uint32_t const*>(p);
+    p += sizeof *index_ * index_size;
+    names_ = reinterpret_cast<std::uint32_t const*>(p);
+    p += sizeof *names_ * count_;
+    strings_ = reinterpret_cast<char const*>(p);
+
+    // Validate once so that lookups need no bounds checks
+    if (0 < strings_size_ && '\0' != strings_[strings_size_ - 1]) {
+        throw invalid;
+    }
+    if (count_ != index_[index_size - 1]) {
+        throw invalid;
+    }
+    for (std::size_t i = 1; i < index_size; i++) {
+        if (index_[i] < index_[i-1]) {
+            throw invalid;
+        }
+    }
+    for (std::uint32_t i = 0; i < count_; i++) {
+        if (unassigned != names_[i] && names_[i] >= strings_size_) {
+            throw invalid;
+        }
+    }
+}
+
+auto OuiTable::open(char const* path) -> OuiTable {
+    return OuiTable{MappedFile::open_readonly(path)};
+}
+
+auto OuiTable::lookup(std::uint64_t mac) const -> std::optional<std::string_view> {
+    auto const bucket = (mac >> 32) & 0xffff;
+    auto const lo = starts_ + index_[bucket];
+    auto const hi = starts_ + index_[bucket + 1];
+
+    // The covering interval may begin in an earlier bucket
+    auto const it = std::upper_bound(lo, hi, mac);
+    if (it == starts_) {
+        return {};
+    }
+    auto const name = names_[it - starts_ - 1];
+    if (unassigned == name) {
+        return {};
+    }
+    return std::string_view{strings_ + name};
+}
+
+auto OuiTable::write(char const* path, std::vector<Assignment> assignments) -> void {
+    struct Block {
+        std::uint64_t start, end;
+        std::uint32_t name;
+    };
+
+    std::string strings;
+    std::unordered_map<std::string, std::uint32_t> interned;
+    std::vector<Block> blocks;
+    blocks.reserve(assignments.size());
+
+    for (auto& a : assignments) {
+        if (a.bits < 1 || 48 < a.bits) {
+            throw std::runtime_error("invalid assignment prefix length");
+        }
+        auto [it, fresh] = interned.try_emplace(std::move(a.name), static_cast<std::uint32_t>(strings.size()));
+        if (fresh) {
+            strings += it->first;
+            strings += '\0';
+        }
+        auto const shift = 48 - a.bits;
+        auto const start = a.prefix << shift;
+        blocks.push_back({start, start + (std::uint64_t{1} << shift), it->second});
+    }
+
+    // Enclosing blocks sort before the blocks carved out of them
+    std::sort(blocks.begin(), blocks.end(), [](auto const& x, auto const& y) {
+        return std::pair(x.start, y.end) < std::pair(y.start, x.end);
+    });
+
+    // Flatten nested blocks into disjoint intervals owned by the most
+    // specific enclosing block.
+    std::vector<Interval> intervals;
+    auto emit = [&](std::uint64_t at, std::uint32_t name) {
+        if (!intervals.empty() && intervals.back().start == at) {
+            intervals.pop_back();
+        }
+        if (intervals.empty() ? unassigned != name : intervals.back().name != name) {
+            intervals.push_back({at, name});
+        }
+    };
+
+    std::vector<Block const*> stack;
+    auto pop = [&] {
+        auto end = stack.back()->end;
+        stack.pop_back();
+        emit(end, stack.empty() ? unassigned : stack.back()->name);
+    };
+
+    for (auto const& block : blocks) {
+        while (!stack.empty() && stack.back()->end <= block.start) {
+            pop();
+        }
+        stack.push_back(&block);
+        emit(block.start, block.name);
+    }
+    while (!stack.empty()) {
+        pop();
+    }
+
+    std::vector<std::uint64_t> starts;
+    std::vector<std::uint32_t> names;
+    starts.reserve(intervals.size());
+    names.reserve(intervals.size());
+    for (auto const& i : intervals) {
+        starts.push_back(i.start);
+        names.push_back(i.name);
+    }
+
+    std::vector<std::uint32_t> index(index_size);
+    for (std::size_t b = 0; b < index_size; b++) {
+        index[b] = static_cast<std::uint32_t>(
+            std::lower_bound(starts.begin(), starts.end(), std::uint64_t{b} << 32) - starts.begin());
+    }
+
+    Header header {};
+    std::memcpy(header.magic, magic, sizeof magic);
+    header.version = version;
+    header.count = static_cast<std::uint32_t>(starts.size());
+    header.strings = strings.size();
+
+    std::ofstream out;
+    out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    out.open(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<char const*>(&header), sizeof header);
+    out.write(reinterpret_cast<char const*>(starts.data()), sizeof starts[0] * starts.size());
+    out.write(reinterpret_cast<char const*>(index.data()), sizeof index[0] * index.size());
+    out.write(reinterpret_cast<char const*>(names.data()), sizeof names[0] * names.size());
+    out.write(strings.data(), strings.size());
+}
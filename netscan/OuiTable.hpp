@@ -0,0 +1,63 @@
+//
+//  OuiTable.hpp
+//  netscan
+//
+
+#ifndef OuiTable_hpp
+#define OuiTable_hpp
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+/// Memory-mapped IEEE MA-L/MA-M/MA-S vendor registry
+///
+/// The table file stores the registry flattened into disjoint address
+/// intervals sorted by first address, with a first-level index on the top
+/// 16 bits of the address. A lookup is an index load followed by a binary
+/// search over the handful of intervals sharing those bits.
+class OuiTable final {
+public:
+    /// A registry block as found in the IEEE CSV files
+    struct Assignment {
+        std::uint64_t prefix; //!< assigned bits, right-aligned
+        int bits;             //!< 24 for MA-L, 28 for MA-M, 36 for MA-S
+        std::string name;
+    };
+
+private:
+    MappedFile file_;
+    std::uint64_t const* starts_;
+    std::uint32_t const* index_;
+    std::uint32_t const* names_;
+    char const* strings_;
+    std::uint32_t count_;
+    std::uint64_t strings_size_;
+
+    explicit OuiTable(MappedFile file);
+
+public:
+    /// Map a table file built by write
+    /// @param path table file
+    /// @exception std::system\_error on failure to map
+    /// @exception std::runtime\_error on malformed table
+    static auto open(char const* path) -> OuiTable;
+
+    /// Build a table file. More specific assignments take precedence
+    /// over the blocks they are carved out of.
+    /// @param path output file
+    /// @param assignments registry entries in any order
+    /// @exception std::runtime\_error on failure to write
+    static auto write(char const* path, std::vector<Assignment> assignments) -> void;
+
+    /// Find the organization a MAC address is assigned to
+    /// @param mac 48-bit address, right-aligned
+    /// @return organization name or empty when unassigned
+    auto lookup(std::uint64_t mac) const -> std::optional<std::string_view>;
+};
+
+#endif /* OuiTable_hpp */
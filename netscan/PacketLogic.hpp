@@ -0,0 +1,271 @@
+//
+//  PacketLogic.hpp
+//  netscan
+//
+
+#ifndef PacketLogic_hpp
+#define PacketLogic_hpp
+
+#include <sys/time.h>
+#include <pcap/pcap.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include "MacSet.hpp"
+#include "OuiTable.hpp"
+#include "ResultRing.hpp" // ResultRecord
+#include "Trace.hpp"
+
+/// Logic to be applied to each of the packets: report each new source MAC,
+/// or each new source MAC and IPv4 address pair
+class PacketLogic {
+public:
+    /// Link-layer header of an Ethernet frame
+    struct Link {
+        uint16_t type;                //!< EtherType of the payload
+        uint32_t offset;              //!< start of the payload
+        std::optional<uint16_t> vlan; //!< outermost 802.1Q VLAN ID, if tagged
+    };
+
+private:
+    // Pairs kept for per_address, about 32 MiB at the limit
+    static constexpr std::size_t max_pairs = std::size_t{1} << 20;
+
+    MacSet macs_;
+    AddressPairSet pairs_;
+    bool per_address_;
+    OuiTable const* oui_;
+    std::function<void(ResultRecord const&)> sink_;
+    std::function<void(pcap_pkthdr const*, u_char const*)> audit_;
+    bool text_;
+
+    static auto get16(u_char const* p) -> uint16_t { return uint16_t(p[0] << 8 | p[1]); }
+    static auto get32(u_char const* p) -> uint32_t { return uint32_t(get16(p)) << 16 | get16(p + 2); }
+
+    /// Dedup key: the address, with the VLAN ID above it for tagged
+    /// replies so a router answering on several VLANs is seen on each
+    static auto key(ResultRecord const& record) -> uint64_t {
+        return record.flags & ResultRecord::has_vlan ? uint64_t(record.vlan) << 48 | record.mac : record.mac;
+    }
+
+    /// Fill in, for echo replies, the round trip measured from the
+    /// timestamp ping embeds in its payload.
+    static auto annotate(pcap_pkthdr const* header, u_char const* data, Link const& l2, ResultRecord& record) -> void {
+        if (0x0800 != l2.type) {
+            return;
+        }
+        auto const caplen = header->caplen;
+        auto const ip = l2.offset;
+        if (caplen < ip + 20) {
+            return;
+        }
+        auto const icmp = ip + 4 * (data[ip] & 0xf);
+        if (1 != data[ip + 9] || caplen < icmp + 8 + sizeof(timeval) || 0 != data[icmp]) {
+            return;
+        }
+        timeval sent;
+        std::memcpy(&sent, data + icmp + 8, sizeof sent);
+        auto const rtt = (int64_t(header->ts.tv_sec) - sent.tv_sec) * 1'000'000
+                       + (int64_t(header->ts.tv_usec) - sent.tv_usec);
+        if (0 <= rtt && rtt < 60'000'000) {
+            record.rtt_us = static_cast<uint32_t>(rtt);
+            record.flags |= ResultRecord::has_rtt;
+        }
+    }
+
+    auto report(ResultRecord& record) -> void {
+        Profile::Scope scope(Profile::output);
+        NETSCAN_TRACE(output_emit, record.mac, record.ipv4, record.flags);
+        if (text_) {
+            print(oui_, record);
+        }
+
+        if (sink_) {
+            sink_(record);
+        }
+    }
+
+public:
+    /// Parse the Ethernet header, stepping over up to two VLAN tags
+    /// @return header or empty when the frame is too short
+    static auto link(pcap_pkthdr const* header, u_char const* data) -> std::optional<Link> {
+        Link result {0, 12, {}};
+        for (auto tags = 0;; tags++) {
+            if (header->caplen < result.offset + 2) {
+                return {};
+            }
+            result.type = get16(data + result.offset);
+            result.offset += 2;
+            if (2 == tags || (0x8100 != result.type && 0x88a8 != result.type)) {
+                return result;
+            }
+            if (header->caplen < result.offset + 2) {
+                return {};
+            }
+            if (!result.vlan) {
+                result.vlan = get16(data + result.offset) & 0xfff;
+            }
+            result.offset += 2;
+        }
+    }
+
+    /// @return IPv4 source of an IPv4 packet or ARP sender protocol address
+    static auto source_ipv4(pcap_pkthdr const* header, u_char const* data, Link const& l2) -> std::optional<uint32_t> {
+        auto const caplen = header->caplen;
+        switch (l2.type) {
+        case 0x0806:
+            if (l2.offset + 18 <= caplen) {
+                return get32(data + l2.offset + 14);
+            }
+            return {};
+        case 0x0800:
+            if (l2.offset + 16 <= caplen) {
+                return get32(data + l2.offset + 12);
+            }
+            return {};
+        default:
+            return {};
+        }
+    }
+
+    /// Print an address to stdout, followed by its IPv4 address or "-".
+    /// Vendor, host name and VLAN columns follow when any of them, or a
+    /// later one, is known.
+    /// @param oui vendor table used to annotate the address, if any
+    /// @param record address to print
+    /// @param hostname name to print after the vendor column, if any
+    static auto print(OuiTable const* oui, ResultRecord const& record, std::optional<std::string_view> hostname = {}) -> void {
+        auto const mac = record.mac;
+        auto text = fmt::format(
+           "{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
+           mac >> 40 & 0xff, mac >> 32 & 0xff, mac >> 24 & 0xff,
+           mac >> 16 & 0xff, mac >>  8 & 0xff, mac       & 0xff);
+        if (record.flags & ResultRecord::has_ipv4) {
+            auto const ipv4 = record.ipv4;
+            text += fmt::format("\t{}.{}.{}.{}", ipv4 >> 24, ipv4 >> 16 & 0xff, ipv4 >> 8 & 0xff, ipv4 & 0xff);
+        } else {
+            text += "\t-";
+        }
+        auto const vlan = 0 != (record.flags & ResultRecord::has_vlan);
+        if (oui || hostname || vlan) {
+            text += '\t';
+            if (oui) {
+                text += oui->lookup(mac).value_or("");
+            }
+        }
+        if (hostname || vlan) {
+            text += '\t';
+            text += hostname.value_or("");
+        }
+        if (vlan) {
+            text += fmt::format("\t{}", record.vlan);
+        }
+        std::cout << text << std::endl;
+    }
+
+    /// @param oui vendor table used to annotate new addresses, if any
+    /// @param sink binary consumer of new addresses, if any
+    /// @param text print new addresses to stdout
+    explicit PacketLogic(OuiTable const* oui = nullptr, std::function<void(ResultRecord const&)> sink = {}, bool text = true)
+      : per_address_{false}, oui_{oui}, sink_{std::move(sink)}, text_{text} {}
+
+    auto operator()(pcap_pkthdr const* pkt_header, u_char const* pkt_data) -> void {
+        auto const l2 = link(pkt_header, pkt_data);
+        if (!l2) {
+            return;
+        }
+        if (audit_) {
+            audit_(pkt_header, pkt_data);
+        }
+        // The source address is at the same offset whether or not the frame is tagged
+        ResultRecord record {};
+        for (auto i = 6; i < 12; i++) {
+            record.mac = record.mac << 8 | pkt_data[i];
+        }
+        if (l2->vlan) {
+            record.vlan = *l2->vlan;
+            record.flags = ResultRecord::has_vlan;
+        }
+
+        auto const ipv4 = source_ipv4(pkt_header, pkt_data, *l2);
+        if (ipv4) {
+            record.ipv4 = *ipv4;
+            record.flags |= ResultRecord::has_ipv4;
+        }
+
+        // Only new addresses pay for formatting and output
+        auto const value = key(record);
+        auto fresh = macs_.insert(value);
+        if (per_address_ && ipv4 && pairs_.size() < max_pairs) {
+            fresh = pairs_.insert(value, *ipv4) || fresh;
+        }
+        if (!fresh) {
+            NETSCAN_TRACE(dedup_hit, value);
+            Profile::count(Profile::dedup_hit);
+        } else {
+            NETSCAN_TRACE(dedup_miss, value);
+            Profile::count(Profile::dedup_miss);
+            record.timestamp_ns = uint64_t(pkt_header->ts.tv_sec) * 1'000'000'000
+                                + uint64_t(pkt_header->ts.tv_usec) * 1'000;
+            annotate(pkt_header, pkt_data, *l2, record);
+            report(record);
+        }
+    }
+
+    /// Also report a known MAC again for each IPv4 address it sends from,
+    /// e.g. a renumbered host or a router answering proxy ARP. Memory is
+    /// bounded: once about a million pairs are known, further addresses of
+    /// known MACs are no longer reported; new MACs still are.
+    auto per_address(bool enable) -> void {
+        per_address_ = enable;
+    }
+
+    /// Keep every accepted packet, duplicates included
+    /// @param writer invoked with each packet before it is deduplicated
+    auto audit(std::function<void(pcap_pkthdr const*, u_char const*)> writer) -> void {
+        audit_ = std::move(writer);
+    }
+
+    /// Merge an address learned outside the capture, e.g. from the kernel
+    /// neighbour table
+    /// @param mac 48-bit address, right-aligned
+    /// @param ipv4 address the MAC was resolved for (host order)
+    auto neighbour(uint64_t mac, uint32_t ipv4) -> void {
+        ResultRecord record {};
+        record.timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        record.mac = mac;
+        record.ipv4 = ipv4;
+        record.flags = ResultRecord::has_ipv4;
+        merge(record);
+    }
+
+    /// Merge a result found elsewhere, e.g. by a remote worker
+    /// @param record result whose address is reported if new
+    auto merge(ResultRecord record) -> void {
+        if (macs_.insert(key(record))) {
+            report(record);
+        }
+    }
+
+    /// @return number of distinct addresses reported
+    auto found() const -> std::size_t { return macs_.size(); }
+
+    /// @return keys reported so far: addresses, with the VLAN ID above
+    /// bit 48 for tagged replies
+    auto macs() const -> MacSet const& { return macs_; }
+
+    /// Treat a key from macs() as already reported
+    auto seen(uint64_t key) -> void { macs_.insert(key); }
+};
+
+#endif /* PacketLogic_hpp */
@@ -74,6 +74,20 @@ auto Pcap::set_nonblock(int x) -> void {
     pcap_setnonblock(pcap_.get(), x, errbuf);
 }
 
+auto Pcap::stats() -> pcap_stat {
+    pcap_stat result {};
+    checked(pcap_stats(pcap_.get(), &result));
+    return result;
+}
+
+auto Pcap::inject(void const* data, std::size_t size) -> void {
+    checked(pcap_inject(pcap_.get(), data, size));
+}
+
+auto Pcap::breakloop() -> void {
+    pcap_breakloop(pcap_.get());
+}
+
 auto Pcap::get() -> pcap_t* {
     return pcap_.get();
 }
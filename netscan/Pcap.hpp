@@ -10,6 +10,7 @@
 
 #include <chrono>
 #include <concepts>
+#include <cstddef>
 #include <memory>
 #include <optional>
 #include <tuple>
@@ -55,6 +56,21 @@ public:
     auto required_select_timeout() -> timeval const*;
     auto set_nonblock(int x) -> void;
 
+    /// Get capture statistics
+    /// @return packets received and dropped since the capture started
+    /// @exception std::runtime\_error on failure
+    auto stats() -> pcap_stat;
+
+    /// Transmit a raw frame on the device
+    /// @param data frame including its link-layer header
+    /// @param size frame length in bytes
+    /// @exception std::runtime\_error on failure
+    auto inject(void const* data, std::size_t size) -> void;
+
+    /// Make a loop or dispatch in progress return early. Safe to call
+    /// from another thread.
+    auto breakloop() -> void;
+
     auto get() -> pcap_t*;
     auto release() -> pcap_t*;
 
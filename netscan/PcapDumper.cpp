@@ -0,0 +1,72 @@
+//
+//  PcapDumper.cpp
+//  netscan
+//
+
+#include "PcapDumper.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+// Block size of writes to the file
+constexpr std::size_t buffer_size = 1 << 20;
+
+// Savefile headers: one per file and one per packet
+constexpr std::uint64_t file_header_size = 24;
+constexpr std::uint64_t packet_header_size = 16;
+
+} // namespace
+
+auto PcapDumper::DumperClose::operator()(pcap_dumper_t* d) const noexcept -> void {
+    pcap_dump_close(d);
+}
+
+PcapDumper::PcapDumper(Pcap& pcap, std::string path, std::uint64_t rotate_bytes)
+  : pcap_{pcap.get()}, path_{std::move(path)}, rotate_bytes_{rotate_bytes}, written_{0}, index_{0}, flushed_{0}, buffer_(buffer_size)
+{
+    open();
+}
+
+auto PcapDumper::open() -> void {
+    // Finish the previous file before its buffer is reused
+    dumper_.reset();
+
+    auto const name = rotate_bytes_ ? path_ + "." + std::to_string(index_++) : path_;
+    auto file = std::fopen(name.c_str(), "wb");
+    if (nullptr == file) {
+        throw std::system_error(errno, std::generic_category(), name);
+    }
+    std::setvbuf(file, buffer_.data(), _IOFBF, buffer_.size());
+
+    auto dumper = pcap_dump_fopen(pcap_, file);
+    if (nullptr == dumper) {
+        std::fclose(file);
+        throw std::runtime_error(pcap_geterr(pcap_));
+    }
+    dumper_.reset(dumper);
+    written_ = file_header_size;
+}
+
+auto PcapDumper::dump(pcap_pkthdr const* header, u_char const* data) -> void {
+    auto const size = packet_header_size + header->caplen;
+    if (rotate_bytes_ && written_ > file_header_size && written_ + size > rotate_bytes_) {
+        open();
+    }
+    pcap_dump(reinterpret_cast<u_char*>(dumper_.get()), header, data);
+    written_ += size;
+    if (header->ts.tv_sec != flushed_) {
+        flushed_ = header->ts.tv_sec;
+        flush();
+    }
+}
+
+auto PcapDumper::flush() -> void {
+    if (-1 == pcap_dump_flush(dumper_.get())) {
+        throw std::runtime_error("failed to write " + path_);
+    }
+}
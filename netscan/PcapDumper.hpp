@@ -0,0 +1,61 @@
+//
+//  PcapDumper.hpp
+//  netscan
+//
+
+#ifndef PcapDumper_hpp
+#define PcapDumper_hpp
+
+#include <pcap/pcap.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Pcap.hpp"
+
+/// Savefile writer for the packets of a capture
+///
+/// Packets are written through a large stdio buffer, so the cost per packet
+/// is a copy and the file sees block-sized writes. The buffer is flushed
+/// whenever a packet's timestamp enters a new second, so a busy capture
+/// reaches the file about once a second without a timer. Optionally the output
+/// rotates to a new file once the current one reaches a size limit.
+class PcapDumper final {
+    struct DumperClose { auto operator()(pcap_dumper_t* d) const noexcept -> void; };
+
+    pcap_t* pcap_;
+    std::string path_;
+    std::uint64_t rotate_bytes_;
+    std::uint64_t written_;
+    unsigned index_;
+    std::time_t flushed_; // capture second of the last flush
+    std::vector<char> buffer_; // outlives the stream using it
+    std::unique_ptr<pcap_dumper_t, DumperClose> dumper_;
+
+    auto open() -> void;
+
+public:
+    /// Start a savefile with the link type and snapshot length of a capture
+    /// @param pcap capture whose packets will be written
+    /// @param path file to write, or with rotation the prefix of PATH.0,
+    /// PATH.1, ...
+    /// @param rotate_bytes size at which to start a new file, or 0 for never
+    /// @exception std::runtime\_error on failure to open
+    PcapDumper(Pcap& pcap, std::string path, std::uint64_t rotate_bytes = 0);
+
+    /// Append a packet
+    /// @param header capture header; caplen bytes of data are written
+    /// @param data packet bytes
+    /// @exception std::runtime\_error on failure to rotate or flush
+    auto dump(pcap_pkthdr const* header, u_char const* data) -> void;
+
+    /// Push buffered packets to the file, e.g. when the capture goes quiet
+    /// @exception std::runtime\_error on write failure
+    auto flush() -> void;
+};
+
+#endif /* PcapDumper_hpp */
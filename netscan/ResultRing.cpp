@@ -0,0 +1,75 @@
+//
+//  ResultRing.cpp
+//  netscan
+//
+
+#include "ResultRing.hpp"
+
+#include <bit>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "MyLibC.hpp"
+
+namespace {
+
+constexpr char magic[8] {'N','S','R','I','N','G','\0','\0'};
+constexpr uint32_t version = 1;
+
+auto records_offset() -> std::size_t {
+    return (sizeof(ResultRingHeader) + alignof(ResultRecord) - 1) / alignof(ResultRecord) * alignof(ResultRecord);
+}
+
+} // namespace
+
+ResultRing::ResultRing(MappedFile file)
+  : file_{std::move(file)}
+  , header_{reinterpret_cast<ResultRingHeader*>(file_.data())}
+  , records_{reinterpret_cast<ResultRecord*>(file_.data() + records_offset())}
+  , mask_{header_->capacity - 1}
+  , head_{0}
+{}
+
+auto ResultRing::create(char const* path, std::size_t capacity) -> ResultRing {
+    capacity = std::bit_ceil(std::max<std::size_t>(capacity, 1));
+
+    // Build the file under a temporary name so readers never see it half made
+    auto tmp = std::string(path) + ".tmp";
+    auto file = MappedFile::create(tmp.c_str(), records_offset() + capacity * sizeof(ResultRecord));
+
+    auto header = new (file.data()) ResultRingHeader{};
+    std::memcpy(header->magic, magic, sizeof magic);
+    header->version = version;
+    header->record_size = sizeof(ResultRecord);
+    header->capacity = capacity;
+    header->head.store(0, std::memory_order_release);
+
+    Rename(tmp.c_str(), path);
+    return ResultRing{std::move(file)};
+}
+
+ResultRingReader::ResultRingReader(MappedFile file)
+  : file_{std::move(file)}
+  , header_{reinterpret_cast<ResultRingHeader const*>(file_.data())}
+  , records_{reinterpret_cast<ResultRecord const*>(file_.data() + records_offset())}
+{
+    auto const invalid = std::runtime_error("malformed result ring");
+    if (file_.size() < records_offset()
+     || 0 != std::memcmp(header_->magic, magic, sizeof magic)
+     || version != header_->version
+     || sizeof(ResultRecord) != header_->record_size
+     || !std::has_single_bit(header_->capacity)
+     || file_.size() != records_offset() + header_->capacity * sizeof(ResultRecord)) {
+        throw invalid;
+    }
+    capacity_ = header_->capacity;
+
+    auto head = header_->head.load(std::memory_order_acquire);
+    next_ = head >= capacity_ ? head - capacity_ + 1 : 0;
+}
+
+auto ResultRingReader::open(char const* path) -> ResultRingReader {
+    return ResultRingReader{MappedFile::open_readonly(path)};
+}
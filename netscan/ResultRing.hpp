@@ -0,0 +1,127 @@
+//
+//  ResultRing.hpp
+//  netscan
+//
+
+#ifndef ResultRing_hpp
+#define ResultRing_hpp
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "MappedFile.hpp"
+
+/// A discovered host as published to the result ring
+struct ResultRecord {
+    static constexpr uint32_t has_ipv4 = 1;
+    static constexpr uint32_t has_rtt = 2;
+    static constexpr uint32_t has_vlan = 4;
+
+    uint64_t timestamp_ns; //!< capture time since the Unix epoch
+    uint64_t mac;          //!< 48-bit address, right-aligned
+    uint32_t ipv4;         //!< source address (host order) when has_ipv4
+    uint32_t rtt_us;       //!< echo round trip when has_rtt
+    uint32_t flags;
+    uint16_t vlan;         //!< 802.1Q VLAN ID of the reply when has_vlan
+    uint16_t reserved;
+};
+static_assert(32 == sizeof(ResultRecord));
+
+/// Layout of the start of a ring file, followed by capacity records
+struct ResultRingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;      //!< number of records, a power of two
+    alignas(64) std::atomic<uint64_t> head; //!< records ever published
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/// Single-producer ring of results in a shared memory-mapped file
+///
+/// The producer never waits for readers: when the ring is full the oldest
+/// records are overwritten, and readers that fall that far behind are told
+/// how many records they lost.
+class ResultRing final {
+    MappedFile file_;
+    ResultRingHeader* header_;
+    ResultRecord* records_;
+    uint64_t mask_;
+    uint64_t head_;
+
+    explicit ResultRing(MappedFile file);
+
+public:
+    /// Create a new ring file, replacing any existing one. Readers attached
+    /// to a replaced file keep their old mapping.
+    /// @param path ring file
+    /// @param capacity minimum number of records, rounded up to a power of two
+    /// @exception std::system\_error on failure to create the file
+    static auto create(char const* path, std::size_t capacity) -> ResultRing;
+
+    /// Publish a record
+    /// @param record record to copy into the ring
+    auto push(ResultRecord const& record) -> void {
+        // Order the previous head update before this slot is overwritten
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&records_[head_ & mask_], &record, sizeof record);
+        header_->head.store(++head_, std::memory_order_release);
+    }
+};
+
+/// Reader attached to a ResultRing file by another process
+class ResultRingReader final {
+    MappedFile file_;
+    ResultRingHeader const* header_;
+    ResultRecord const* records_;
+    uint64_t capacity_;
+    uint64_t next_;
+
+    explicit ResultRingReader(MappedFile file);
+
+public:
+    /// Attach to a ring file, starting at the oldest record that is safe
+    /// to read
+    /// @param path ring file
+    /// @exception std::system\_error on failure to map
+    /// @exception std::runtime\_error on malformed ring
+    static auto open(char const* path) -> ResultRingReader;
+
+    /// Deliver the records published since the last call
+    /// @param callback invoked with a copy of each record
+    /// @return number of records overwritten before they could be read
+    template <std::invocable<ResultRecord const&> Callback>
+    auto poll(Callback&& callback) -> uint64_t {
+        uint64_t lost = 0;
+        auto head = header_->head.load(std::memory_order_acquire);
+        while (next_ < head) {
+            // The slot after the newest record may be mid-write at any time
+            if (head - next_ >= capacity_) {
+                auto oldest = head - capacity_ + 1;
+                lost += oldest - next_;
+                next_ = oldest;
+                continue;
+            }
+
+            ResultRecord record;
+            std::memcpy(&record, &records_[next_ & (capacity_ - 1)], sizeof record);
+
+            // The copy is only good if the producer had not yet begun to
+            // reuse the slot by the time it finished.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            head = header_->head.load(std::memory_order_relaxed);
+            if (head - next_ >= capacity_) {
+                continue;
+            }
+
+            callback(record);
+            next_++;
+        }
+        return lost;
+    }
+};
+
+#endif /* ResultRing_hpp */
@@ -0,0 +1,442 @@
+//
+//  ReverseDns.cpp
+//  netscan
+//
+
+#include "ReverseDns.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include "MyLibC.hpp"
+
+namespace {
+
+constexpr uint16_t type_ptr = 12;
+constexpr uint16_t class_in = 1;
+constexpr int rcode_nxdomain = 3;
+
+// Large enough for any query and for the UDP answers we accept
+constexpr std::size_t max_message = 1232;
+
+auto get16(unsigned char const* p) -> uint16_t { return uint16_t(p[0] << 8 | p[1]); }
+auto get32(unsigned char const* p) -> uint32_t { return uint32_t(get16(p)) << 16 | get16(p + 2); }
+
+auto put16(unsigned char*& p, uint16_t x) -> void {
+    *p++ = static_cast<unsigned char>(x >> 8);
+    *p++ = static_cast<unsigned char>(x);
+}
+
+/// @return name queried for an address, e.g. 4.3.2.1.in-addr.arpa
+auto ptr_name(uint32_t ipv4) -> std::string {
+    std::string result;
+    for (auto shift = 0; shift < 32; shift += 8) {
+        result += std::to_string(ipv4 >> shift & 0xff);
+        result += '.';
+    }
+    return result + "in-addr.arpa";
+}
+
+auto encode_query(uint16_t id, uint32_t ipv4, unsigned char* out) -> std::size_t {
+    auto p = out;
+    put16(p, id);
+    put16(p, 0x0100); // recursion desired
+    put16(p, 1);
+    put16(p, 0);
+    put16(p, 0);
+    put16(p, 0);
+
+    auto const full = ptr_name(ipv4);
+    std::string_view name = full;
+    while (!name.empty()) {
+        auto const dot = std::min(name.find('.'), name.size());
+        *p++ = static_cast<unsigned char>(dot);
+        p = std::copy_n(name.begin(), dot, p);
+        name.remove_prefix(std::min(dot + 1, name.size()));
+    }
+    *p++ = 0;
+    put16(p, type_ptr);
+    put16(p, class_in);
+    return static_cast<std::size_t>(p - out);
+}
+
+/// Read a possibly compressed domain name
+/// @return offset just past the name where it appears, or empty if malformed
+auto read_name(unsigned char const* msg, std::size_t len, std::size_t pos, std::string& name) -> std::optional<std::size_t> {
+    name.clear();
+    std::optional<std::size_t> end;
+    for (auto jumps = 0; jumps < 16;) {
+        if (pos >= len) {
+            return {};
+        }
+        auto const n = msg[pos];
+        if (0 == n) {
+            return end ? end : pos + 1;
+        }
+        if (0xc0 == (n & 0xc0)) {
+            if (pos + 1 >= len) {
+                return {};
+            }
+            if (!end) {
+                end = pos + 2;
+            }
+            pos = get16(msg + pos) & 0x3fff;
+            jumps++;
+        } else if (0 == (n & 0xc0) && pos + 1 + n <= len) {
+            if (!name.empty()) {
+                name += '.';
+            }
+            name.append(reinterpret_cast<char const*>(msg + pos + 1), n);
+            pos += 1 + n;
+        } else {
+            return {};
+        }
+    }
+    return {};
+}
+
+auto same_name(std::string_view a, std::string_view b) -> bool {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+/// Host names end up in tab-separated output, one host per line, so a
+/// name with whitespace or control bytes could forge columns or lines
+auto printable(std::string_view name) -> bool {
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return 0x20 < static_cast<unsigned char>(c) && static_cast<unsigned char>(c) < 0x7f;
+    });
+}
+
+} // namespace
+
+auto ReverseDns::decode(unsigned char const* msg, std::size_t len) -> std::optional<Response> {
+    if (len < 12 || 0 == (msg[2] & 0x80) || 1 != get16(msg + 4)) {
+        return {};
+    }
+    Response r {get16(msg), msg[3] & 0xf, {}, {}, 0};
+
+    auto pos = read_name(msg, len, 12, r.question);
+    if (!pos || *pos + 4 > len) {
+        return {};
+    }
+    *pos += 4;
+
+    std::string owner;
+    for (auto answers = get16(msg + 6); 0 < answers; answers--) {
+        pos = read_name(msg, len, *pos, owner);
+        if (!pos || *pos + 10 > len) {
+            return {};
+        }
+        auto const type = get16(msg + *pos);
+        auto const ttl = get32(msg + *pos + 4);
+        auto const rdlength = get16(msg + *pos + 8);
+        auto const rdata = *pos + 10;
+        if (rdata + rdlength > len) {
+            return {};
+        }
+        // Classless delegations answer with a CNAME first; take the first
+        // PTR that is a usable host name
+        if (type_ptr == type && read_name(msg, len, rdata, r.name) && printable(r.name)) {
+            r.ttl = ttl;
+            break;
+        }
+        r.name.clear();
+        *pos = rdata + rdlength;
+    }
+    return r;
+}
+
+ReverseDns::ReverseDns(sockaddr_in const& server, Config config)
+  : config_{config}, outstanding_{0}, stop_{false}, next_id_{static_cast<uint16_t>(std::random_device{}())}
+{
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (-1 == fd_) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    FcntlSetFd(fd_, FD_CLOEXEC | FcntlGetFd(fd_));
+    fcntl(fd_, F_SETFL, O_NONBLOCK | fcntl(fd_, F_GETFL));
+    if (-1 == connect(fd_, reinterpret_cast<sockaddr const*>(&server), sizeof server)) {
+        auto e = errno;
+        Close(fd_);
+        throw std::system_error(e, std::generic_category(), "connect");
+    }
+
+    auto [r, w] = Pipe();
+    wake_read_ = r;
+    wake_write_ = w;
+    for (auto fd : {r, w}) {
+        FcntlSetFd(fd, FD_CLOEXEC | FcntlGetFd(fd));
+        fcntl(fd, F_SETFL, O_NONBLOCK | fcntl(fd, F_GETFL));
+    }
+
+    // Keep SIGCHLD for the scan thread's wait
+    sigset_t all;
+    sigfillset(&all);
+    auto const old = Sigprocmask(SIG_BLOCK, all);
+    thread_ = std::thread([this] { run(); });
+    Sigprocmask(SIG_SETMASK, old);
+}
+
+ReverseDns::~ReverseDns() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    char const byte = 0;
+    (void)write(wake_write_, &byte, 1);
+    thread_.join();
+    Close(fd_);
+    Close(wake_read_);
+    Close(wake_write_);
+}
+
+auto ReverseDns::server(std::string const& text) -> sockaddr_in {
+    std::string address = text;
+    if (address.empty()) {
+        std::ifstream conf("/etc/resolv.conf");
+        std::string line;
+        while (address.empty() && std::getline(conf, line)) {
+            std::istringstream words(line);
+            std::string keyword, value;
+            if (words >> keyword >> value && "nameserver" == keyword && InAddrPton(value.c_str())) {
+                address = value;
+            }
+        }
+        if (address.empty()) {
+            throw std::runtime_error("no IPv4 nameserver in /etc/resolv.conf");
+        }
+    }
+
+    sockaddr_in result {};
+    result.sin_family = AF_INET;
+    result.sin_port = htons(53);
+
+    auto const colon = address.find(':');
+    if (colon != std::string::npos) {
+        auto const port = address.substr(colon + 1);
+        std::size_t used = 0;
+        int value = -1;
+        try {
+            value = std::stoi(port, &used);
+        } catch (std::exception const&) {}
+        if (used != port.size() || value <= 0 || value > 65535) {
+            throw std::runtime_error("bad DNS server port: " + port);
+        }
+        result.sin_port = htons(static_cast<uint16_t>(value));
+        address.resize(colon);
+    }
+
+    auto const addr = InAddrPton(address.c_str());
+    if (!addr) {
+        throw std::runtime_error("bad DNS server address: " + address);
+    }
+    result.sin_addr.s_addr = *addr;
+    return result;
+}
+
+auto ReverseDns::lookup(ResultRecord const& record) -> void {
+    bool wake;
+    {
+        std::lock_guard lock(mutex_);
+        wake = requests_.empty();
+        requests_.push_back(record);
+        outstanding_++;
+    }
+    if (wake) {
+        char const byte = 0;
+        (void)write(wake_write_, &byte, 1);
+    }
+}
+
+auto ReverseDns::outstanding() -> std::size_t {
+    std::lock_guard lock(mutex_);
+    return outstanding_;
+}
+
+auto ReverseDns::poll() -> std::vector<Answer> {
+    std::vector<Answer> result;
+    std::lock_guard lock(mutex_);
+    result.swap(answers_);
+    outstanding_ -= result.size();
+    return result;
+}
+
+auto ReverseDns::wait() -> std::vector<Answer> {
+    std::vector<Answer> result;
+    std::unique_lock lock(mutex_);
+    answered_.wait(lock, [this] { return 0 == outstanding_ || !answers_.empty(); });
+    result.swap(answers_);
+    outstanding_ -= result.size();
+    return result;
+}
+
+auto ReverseDns::run() -> void {
+    std::vector<ResultRecord> requests;
+    for (;;) {
+        {
+            std::lock_guard lock(mutex_);
+            if (stop_) {
+                return;
+            }
+            requests.swap(requests_);
+        }
+
+        auto now = clock::now();
+        for (auto const& record : requests) {
+            submit(record, now);
+        }
+        requests.clear();
+
+        expire(now);
+        while (inflight_.size() < config_.inflight && !waiting_.empty()) {
+            send(waiting_.front(), 1, now);
+            waiting_.pop_front();
+        }
+
+        if (!finished_.empty()) {
+            {
+                std::lock_guard lock(mutex_);
+                std::move(finished_.begin(), finished_.end(), std::back_inserter(answers_));
+            }
+            finished_.clear();
+            answered_.notify_all();
+        }
+
+        std::optional<std::chrono::milliseconds> timeout;
+        if (!timeouts_.empty()) {
+            timeout = std::chrono::ceil<std::chrono::milliseconds>(
+                std::max(clock::duration::zero(), timeouts_.front().second - now));
+        }
+        pollfd fds[] {{fd_, POLLIN, 0}, {wake_read_, POLLIN, 0}};
+        if (0 < Poll(fds, timeout)) {
+            char buffer[64];
+            while (0 < read(wake_read_, buffer, sizeof buffer)) {}
+            receive(clock::now());
+        }
+    }
+}
+
+auto ReverseDns::submit(ResultRecord const& record, clock::time_point now) -> void {
+    if (auto it = cache_.find(record.ipv4); it != cache_.end()) {
+        if (now < it->second.expires) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            finished_.push_back({record, it->second.name});
+            return;
+        }
+        lru_.erase(it->second.lru);
+        cache_.erase(it);
+    }
+
+    // Concurrent lookups of one address share a query
+    auto& waiters = waiters_[record.ipv4];
+    if (waiters.empty()) {
+        waiting_.push_back(record.ipv4);
+    }
+    waiters.push_back(record);
+}
+
+auto ReverseDns::send(uint32_t ipv4, int attempts, clock::time_point now) -> void {
+    while (inflight_.contains(next_id_)) {
+        next_id_++;
+    }
+    auto const id = next_id_++;
+
+    unsigned char query[max_message];
+    auto const len = encode_query(id, ipv4, query);
+    // A failed send is handled like a lost datagram
+    (void)::send(fd_, query, len, 0);
+
+    auto const deadline = now + config_.timeout;
+    inflight_[id] = {ipv4, attempts, deadline};
+    timeouts_.emplace_back(id, deadline);
+}
+
+auto ReverseDns::receive(clock::time_point now) -> void {
+    unsigned char message[max_message];
+    for (;;) {
+        auto const n = recv(fd_, message, sizeof message, 0);
+        if (n < 0) {
+            // An unreachable server leaves its queries to time out
+            if (EINTR == errno || ECONNREFUSED == errno) {
+                continue;
+            }
+            return;
+        }
+
+        auto response = decode(message, static_cast<std::size_t>(n));
+        if (!response) {
+            continue;
+        }
+        auto it = inflight_.find(response->id);
+        if (it == inflight_.end() || !same_name(response->question, ptr_name(it->second.ipv4))) {
+            continue;
+        }
+        auto const ipv4 = it->second.ipv4;
+        inflight_.erase(it);
+
+        if (0 == response->rcode && !response->name.empty()) {
+            resolve(ipv4, response->name, std::chrono::seconds{response->ttl}, now);
+        } else if (0 == response->rcode || rcode_nxdomain == response->rcode) {
+            resolve(ipv4, {}, config_.negative_ttl, now);
+        } else {
+            resolve(ipv4, {}, std::chrono::seconds{0}, now);
+        }
+    }
+}
+
+auto ReverseDns::expire(clock::time_point now) -> void {
+    while (!timeouts_.empty() && timeouts_.front().second <= now) {
+        auto const [id, deadline] = timeouts_.front();
+        timeouts_.pop_front();
+
+        // Entries for answered or already retried queries are stale
+        auto it = inflight_.find(id);
+        if (it == inflight_.end() || it->second.deadline != deadline) {
+            continue;
+        }
+        auto const query = it->second;
+        inflight_.erase(it);
+        if (query.attempts <= config_.retries) {
+            send(query.ipv4, query.attempts + 1, now);
+        } else {
+            resolve(query.ipv4, {}, std::chrono::seconds{0}, now);
+        }
+    }
+}
+
+auto ReverseDns::resolve(uint32_t ipv4, std::string const& name, std::chrono::seconds ttl, clock::time_point now) -> void {
+    if (0 < ttl.count() && 0 < config_.cache) {
+        if (cache_.size() >= config_.cache) {
+            cache_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(ipv4);
+        cache_[ipv4] = {name, now + std::min(ttl, config_.max_ttl), lru_.begin()};
+    }
+
+    auto it = waiters_.find(ipv4);
+    if (it == waiters_.end()) {
+        return;
+    }
+    for (auto const& record : it->second) {
+        finished_.push_back({record, name});
+    }
+    waiters_.erase(it);
+}
@@ -0,0 +1,143 @@
+//
+//  ReverseDns.hpp
+//  netscan
+//
+
+#ifndef ReverseDns_hpp
+#define ReverseDns_hpp
+
+#include <netinet/in.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ResultRing.hpp" // ResultRecord
+
+/// Resolves PTR names for discovered hosts on a background thread
+///
+/// Lookups are queued without waiting on the network and sent as UDP
+/// queries straight to one server, many at a time. Answers, including
+/// negative ones, are kept in a bounded least-recently-used cache for the
+/// TTL the server gave them.
+class ReverseDns final {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// A finished lookup
+    struct Answer {
+        ResultRecord record; //!< record passed to lookup
+        std::string name;    //!< host name or empty when there is none
+    };
+
+    /// A parsed answer to a PTR query
+    struct Response {
+        uint16_t id;
+        int rcode;
+        std::string question; //!< name that was queried
+        std::string name;     //!< first usable PTR name or empty
+        uint32_t ttl;         //!< TTL of the PTR record
+    };
+
+    struct Config {
+        std::size_t inflight = 64;  //!< concurrent queries
+        std::size_t cache = 4096;   //!< cached addresses
+        int retries = 1;            //!< retransmissions of unanswered queries
+        clock::duration timeout = std::chrono::seconds{1};
+        std::chrono::seconds negative_ttl = std::chrono::seconds{60};
+        std::chrono::seconds max_ttl = std::chrono::hours{1};
+    };
+
+private:
+    struct Query {
+        uint32_t ipv4;
+        int attempts;
+        clock::time_point deadline;
+    };
+
+    struct CacheEntry {
+        std::string name;
+        clock::time_point expires;
+        std::list<uint32_t>::iterator lru;
+    };
+
+    Config config_;
+    int fd_;
+    int wake_read_;
+    int wake_write_;
+
+    // Shared with callers
+    std::mutex mutex_;
+    std::condition_variable answered_;
+    std::vector<ResultRecord> requests_;
+    std::vector<Answer> answers_;
+    std::size_t outstanding_;
+    bool stop_;
+
+    // Owned by the resolver thread
+    std::unordered_map<uint32_t, std::vector<ResultRecord>> waiters_;
+    std::deque<uint32_t> waiting_;
+    std::unordered_map<uint16_t, Query> inflight_;
+    std::deque<std::pair<uint16_t, clock::time_point>> timeouts_;
+    std::unordered_map<uint32_t, CacheEntry> cache_;
+    std::list<uint32_t> lru_;
+    std::vector<Answer> finished_;
+    uint16_t next_id_;
+
+    std::thread thread_;
+
+    auto run() -> void;
+    auto submit(ResultRecord const& record, clock::time_point now) -> void;
+    auto send(uint32_t ipv4, int attempts, clock::time_point now) -> void;
+    auto receive(clock::time_point now) -> void;
+    auto expire(clock::time_point now) -> void;
+    auto resolve(uint32_t ipv4, std::string const& name, std::chrono::seconds ttl, clock::time_point now) -> void;
+
+public:
+    /// Start the resolver thread
+    /// @param server DNS server address and port
+    /// @param config limits and timeouts
+    /// @exception std::system\_error on failure to open the socket
+    explicit ReverseDns(sockaddr_in const& server, Config config);
+    explicit ReverseDns(sockaddr_in const& server) : ReverseDns(server, Config{}) {}
+    ~ReverseDns();
+    ReverseDns(ReverseDns const&) = delete;
+    auto operator=(ReverseDns const&) -> ReverseDns& = delete;
+
+    /// Parse a server of the form `ADDRESS[:PORT]`, or when empty use the
+    /// first IPv4 nameserver in /etc/resolv.conf
+    /// @exception std::runtime\_error on malformed server or no nameserver
+    static auto server(std::string const& text) -> sockaddr_in;
+
+    /// Parse a DNS response, keeping the first PTR answer whose name holds
+    /// only printable, non-blank ASCII
+    /// @param msg UDP payload
+    /// @param len payload length
+    /// @return response or empty when malformed
+    static auto decode(unsigned char const* msg, std::size_t len) -> std::optional<Response>;
+
+    /// Queue a lookup of a record's IPv4 address. Never waits on the network.
+    /// @param record record with has\_ipv4 set, returned with the answer
+    auto lookup(ResultRecord const& record) -> void;
+
+    /// @return lookups queued and not yet collected by poll or wait
+    auto outstanding() -> std::size_t;
+
+    /// @return lookups finished since the last call, without waiting
+    auto poll() -> std::vector<Answer>;
+
+    /// Wait for at least one lookup to finish when any are outstanding
+    /// @return lookups finished since the last call
+    auto wait() -> std::vector<Answer>;
+};
+
+#endif /* ReverseDns_hpp */
@@ -0,0 +1,135 @@
+//
+//  Rtnetlink.cpp
+//  netscan
+//
+
+#include "Rtnetlink.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#ifdef __linux__
+
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+
+#include <cstring>
+
+#include "MyLibC.hpp"
+
+auto ParseNeighbours(void const* buffer, std::size_t len, uint32_t seq, std::vector<Neighbour>& result) -> bool {
+    constexpr auto usable = NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT;
+
+    auto left = static_cast<unsigned>(len);
+    for (auto h = static_cast<nlmsghdr const*>(buffer); NLMSG_OK(h, left); h = NLMSG_NEXT(h, left)) {
+        if (h->nlmsg_seq != seq) {
+            continue;
+        }
+        if (NLMSG_DONE == h->nlmsg_type) {
+            return true;
+        }
+        if (NLMSG_ERROR == h->nlmsg_type) {
+            if (h->nlmsg_len < NLMSG_LENGTH(sizeof(nlmsgerr))) {
+                throw std::system_error(EPROTO, std::generic_category(), "RTM_GETNEIGH");
+            }
+            auto err = static_cast<nlmsgerr const*>(NLMSG_DATA(h));
+            throw std::system_error(-err->error, std::generic_category(), "RTM_GETNEIGH");
+        }
+        if (RTM_NEWNEIGH != h->nlmsg_type || h->nlmsg_len < NLMSG_LENGTH(sizeof(ndmsg))) {
+            continue;
+        }
+
+        auto nd = static_cast<ndmsg const*>(NLMSG_DATA(h));
+        if (AF_INET != nd->ndm_family || 0 == (nd->ndm_state & usable)) {
+            continue;
+        }
+
+        Neighbour entry {nd->ndm_ifindex, 0, 0};
+        auto have = 0;
+        auto attrlen = static_cast<unsigned>(NLMSG_PAYLOAD(h, sizeof *nd));
+        auto a = reinterpret_cast<rtattr const*>(reinterpret_cast<char const*>(nd) + NLMSG_ALIGN(sizeof *nd));
+        for (; RTA_OK(a, attrlen); a = RTA_NEXT(a, attrlen)) {
+            auto data = static_cast<unsigned char const*>(RTA_DATA(a));
+            if (NDA_DST == a->rta_type && 4 == RTA_PAYLOAD(a)) {
+                entry.ipv4 = uint32_t(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+                have |= 1;
+            } else if (NDA_LLADDR == a->rta_type && 6 == RTA_PAYLOAD(a)) {
+                for (auto i = 0; i < 6; i++) {
+                    entry.mac = entry.mac << 8 | data[i];
+                }
+                have |= 2;
+            }
+        }
+        if (3 == have) {
+            result.push_back(entry);
+        }
+    }
+    return false;
+}
+
+Rtnetlink::Rtnetlink() : seq_{0} {
+    fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (-1 == fd_) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+}
+
+Rtnetlink::~Rtnetlink() {
+    Close(fd_);
+}
+
+auto Rtnetlink::neighbours() -> std::vector<Neighbour> {
+    struct {
+        nlmsghdr header;
+        ndmsg body;
+    } request {};
+    request.header.nlmsg_len = sizeof request;
+    request.header.nlmsg_type = RTM_GETNEIGH;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++seq_;
+    request.body.ndm_family = AF_INET;
+
+    sockaddr_nl kernel {};
+    kernel.nl_family = AF_NETLINK;
+    if (-1 == sendto(fd_, &request, sizeof request, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof kernel)) {
+        throw std::system_error(errno, std::generic_category(), "sendto");
+    }
+
+    std::vector<Neighbour> result;
+    alignas(nlmsghdr) char buffer[32768];
+
+    for (;;) {
+        auto n = recv(fd_, buffer, sizeof buffer, 0);
+        if (-1 == n) {
+            auto e = errno;
+            if (EINTR == e) {
+                continue;
+            }
+            throw std::system_error(e, std::generic_category(), "recv");
+        }
+
+        if (ParseNeighbours(buffer, static_cast<std::size_t>(n), seq_, result)) {
+            return result;
+        }
+    }
+}
+
+#else
+
+auto ParseNeighbours(void const*, std::size_t, uint32_t, std::vector<Neighbour>&) -> bool {
+    throw std::system_error(ENOTSUP, std::generic_category(), "rtnetlink");
+}
+
+Rtnetlink::Rtnetlink() : fd_{-1}, seq_{0} {
+    throw std::system_error(ENOTSUP, std::generic_category(), "rtnetlink");
+}
+
+Rtnetlink::~Rtnetlink() = default;
+
+auto Rtnetlink::neighbours() -> std::vector<Neighbour> {
+    return {};
+}
+
+#endif
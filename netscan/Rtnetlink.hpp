@@ -0,0 +1,52 @@
+//
+//  Rtnetlink.hpp
+//  netscan
+//
+
+#ifndef Rtnetlink_hpp
+#define Rtnetlink_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Resolved entry of the kernel's IPv4 neighbour (ARP) table
+struct Neighbour {
+    int ifindex;
+    uint32_t ipv4; //!< host order
+    uint64_t mac;  //!< 48-bit address, right-aligned
+};
+
+/// Decode one datagram of an RTM\_GETNEIGH dump, keeping resolved IPv4
+/// entries with an Ethernet address
+/// @param buffer datagram, aligned for nlmsghdr
+/// @param len datagram length
+/// @param seq sequence number of the request; other messages are ignored
+/// @param result resolved neighbours are appended here
+/// @return true once the end of the dump has been seen
+/// @exception std::system\_error on a netlink error message
+auto ParseNeighbours(void const* buffer, std::size_t len, uint32_t seq, std::vector<Neighbour>& result) -> bool;
+
+/// Route netlink socket used to read the kernel neighbour table
+///
+/// Only available on Linux; elsewhere construction fails.
+class Rtnetlink final {
+    int fd_;
+    uint32_t seq_;
+
+public:
+    /// Open a NETLINK\_ROUTE socket
+    /// @exception std::system\_error on failure
+    Rtnetlink();
+    ~Rtnetlink();
+    Rtnetlink(Rtnetlink const&) = delete;
+    auto operator=(Rtnetlink const&) -> Rtnetlink& = delete;
+
+    /// Dump the IPv4 neighbour table with a single request, keeping only
+    /// entries with a usable link-layer address.
+    /// @return resolved neighbours
+    /// @exception std::system\_error on socket failure or netlink error
+    auto neighbours() -> std::vector<Neighbour>;
+};
+
+#endif /* Rtnetlink_hpp */
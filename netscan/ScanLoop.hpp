@@ -0,0 +1,362 @@
+//
+//  ScanLoop.hpp
+//  netscan
+//
+
+#ifndef ScanLoop_hpp
+#define ScanLoop_hpp
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "TargetRange.hpp"
+#include "TimerWheel.hpp"
+#include "Trace.hpp"
+
+/// Source of the current time for the scan
+template <class T>
+concept ScanClock = requires (T& clock) {
+    { clock.now() } -> std::same_as<TimerWheel::clock::time_point>;
+};
+
+/// Generates the addresses to probe
+///
+/// pop returns the next address while the source is not empty, and cursor
+/// a position from which an interrupted scan can resume.
+template <class T>
+concept TargetSource = requires (T& targets) {
+    { targets.empty() } -> std::convertible_to<bool>;
+    { targets.pop() } -> std::same_as<uint32_t>;
+    { targets.cursor() } -> std::convertible_to<uint32_t>;
+};
+
+/// Launches probes and reports their completion
+///
+/// spawn starts a probe and returns its handle, kill aborts a running
+/// probe, and reap returns a completed probe's handle and whether it was
+/// answered, or nothing when no more probes have completed.
+template <class T>
+concept ProbeSender = requires (T& sender, uint32_t addr, pid_t pid) {
+    { sender.spawn(addr) } -> std::same_as<pid_t>;
+    sender.kill(pid);
+    { sender.reap() } -> std::same_as<std::optional<std::pair<pid_t, bool>>>;
+};
+
+/// Waits for scan events and delivers captured packets
+///
+/// wait blocks until the deadline and returns 1 when packets are ready,
+/// -1 when probes have completed and 0 otherwise.
+template <class T, class Handler>
+concept PacketSource = requires (T& source, std::optional<TimerWheel::clock::time_point> deadline, Handler& handler) {
+    { source.wait(deadline) } -> std::convertible_to<int>;
+    source.dispatch(handler);
+};
+
+/// Packet sources may also report whether they are losing packets, in
+/// which case the scan slows down until they recover.
+template <class T>
+concept CongestionSource = requires (T& source) {
+    { source.congested() } -> std::convertible_to<bool>;
+};
+
+/// The real steady clock
+struct SteadyClock {
+    auto now() const -> TimerWheel::clock::time_point {
+        return TimerWheel::clock::now();
+    }
+};
+
+/// An outstanding probe. While pid is set the timer bounds the lifetime of
+/// the probe, otherwise it is waiting for its retry.
+struct Probe : TimerWheel::Timer {
+    pid_t pid;
+    uint32_t addr;
+    int attempts;
+};
+
+/// Tracks outstanding probes in a fixed pool sized by the spawn limit
+template <ProbeSender Sender>
+class ProbeLogic {
+    using time_point = TimerWheel::clock::time_point;
+    static constexpr auto kill_after = std::chrono::seconds{5};
+    static constexpr auto retry_after = std::chrono::seconds{1};
+
+    Sender& sender_;
+    TimerWheel& wheel_;
+    std::vector<Probe> probes_;
+    std::vector<Probe*> free_;
+    std::unordered_map<pid_t, Probe*> running_;
+    std::size_t limit_;
+    int retries_;
+
+    auto start(Probe& probe, time_point now) -> void {
+        {
+            Profile::Scope scope(Profile::spawn);
+            probe.pid = sender_.spawn(probe.addr);
+        }
+        probe.attempts++;
+        NETSCAN_TRACE(probe_send, probe.addr, probe.attempts);
+        running_.emplace(probe.pid, &probe);
+        wheel_.schedule(probe, now + kill_after);
+    }
+
+    auto finished(pid_t pid, bool replied, time_point now) -> void {
+        auto it = running_.find(pid);
+        if (it == running_.end()) {
+            return;
+        }
+        auto& probe = *it->second;
+        running_.erase(it);
+        probe.pid = 0;
+        if (replied || probe.attempts > retries_) {
+            wheel_.cancel(probe);
+            free_.push_back(&probe);
+        } else {
+            wheel_.schedule(probe, now + retry_after);
+        }
+    }
+
+public:
+    ProbeLogic(Sender& sender, TimerWheel& wheel, int limit, int retries)
+      : sender_{sender}, wheel_{wheel}, probes_(limit), limit_{probes_.size()}, retries_{retries}
+    {
+        free_.reserve(probes_.size());
+        running_.reserve(probes_.size());
+        for (auto& probe : probes_) {
+            probe.pid = 0;
+            free_.push_back(&probe);
+        }
+    }
+
+    /// @return true when no more probes can be launched
+    auto full() const -> bool { return probes_.size() - free_.size() >= limit_; }
+
+    /// @return size of the probe pool
+    auto capacity() const -> std::size_t { return probes_.size(); }
+
+    /// Restrict the number of concurrent probes below the pool size
+    /// @param limit new concurrency limit
+    auto throttle(std::size_t limit) -> void { limit_ = limit; }
+
+    /// @return true when no probes are running or awaiting retry
+    auto idle() const -> bool { return free_.size() == probes_.size(); }
+
+    /// @return addresses of probes that are running or awaiting retry
+    auto outstanding() const -> std::vector<uint32_t> {
+        std::vector<uint32_t> result;
+        for (auto const& probe : probes_) {
+            if (probe.pid || probe.active()) {
+                result.push_back(probe.addr);
+            }
+        }
+        return result;
+    }
+
+    auto launch(uint32_t addr, time_point now) -> void {
+        auto& probe = *free_.back();
+        free_.pop_back();
+        probe.addr = addr;
+        probe.attempts = 0;
+        start(probe, now);
+    }
+
+    /// Collect all completed probes
+    auto reap(time_point now) -> void {
+        while (!running_.empty()) {
+            auto done = sender_.reap();
+            if (!done) {
+                break;
+            }
+            finished(done->first, done->second, now);
+        }
+    }
+
+    /// Handle an expired probe timer: stuck probes are killed and will be
+    /// reaped normally, retries are launched.
+    auto expire(Probe& probe, time_point now) -> void {
+        if (probe.pid) {
+            sender_.kill(probe.pid);
+        } else {
+            start(probe, now);
+        }
+    }
+};
+
+/// Additive-increase, multiplicative-decrease control of probe concurrency
+class Backpressure {
+    std::size_t max_;
+    std::size_t limit_;
+public:
+    explicit Backpressure(std::size_t max) : max_{max}, limit_{max} {}
+
+    /// Update the limit from a congestion sample: halve it on congestion,
+    /// otherwise recover linearly to the maximum over twenty samples.
+    /// @param congested whether packets were lost since the last sample
+    /// @return new concurrency limit
+    auto sample(bool congested) -> std::size_t {
+        if (congested) {
+            limit_ = std::max<std::size_t>(1, limit_ / 2);
+        } else {
+            limit_ = std::min(max_, limit_ + std::max<std::size_t>(1, max_ / 20));
+        }
+        return limit_;
+    }
+};
+
+/// Probe a range of addresses, reporting captured replies
+///
+/// The loop is parameterized on its probe sender, packet source and clock
+/// so that the production instantiation has no indirection while the same
+/// logic can be driven by a simulated network.
+template <ProbeSender Sender, class Source, ScanClock Clock>
+class ScanLoop {
+    Source& source_;
+    Clock& clock_;
+    TimerWheel wheel_;
+    ProbeLogic<Sender> probeLogic_;
+    Backpressure backpressure_;
+    TimerWheel::clock::duration checkpoint_interval_;
+    std::function<void(uint32_t, std::vector<uint32_t> const&)> checkpoint_;
+
+    struct Periodic : TimerWheel::Timer {
+        TimerWheel::clock::duration interval;
+        std::function<void()> task;
+    };
+    std::list<Periodic> periodic_;
+
+    auto find_periodic(TimerWheel::Timer& timer) -> Periodic* {
+        for (auto& p : periodic_) {
+            if (&p == &timer) {
+                return &p;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    ScanLoop(Sender& sender, Source& source, Clock& clock, int limit, int retries)
+      : source_{source}
+      , clock_{clock}
+      , wheel_{std::chrono::milliseconds{10}, clock.now()}
+      , probeLogic_{sender, wheel_, limit, retries}
+      , backpressure_{probeLogic_.capacity()}
+      , checkpoint_interval_{}
+    {}
+
+    /// Periodically report progress so that an interrupted scan can resume
+    /// @param interval time between reports
+    /// @param save invoked with the next range address to probe and the
+    /// addresses of outstanding probes
+    auto checkpoint(TimerWheel::clock::duration interval, std::function<void(uint32_t, std::vector<uint32_t> const&)> save) -> void {
+        checkpoint_interval_ = interval;
+        checkpoint_ = std::move(save);
+    }
+
+    /// Run a task at a fixed interval while probes are being sent
+    /// @param interval time between runs
+    /// @param task work to perform
+    auto every(TimerWheel::clock::duration interval, std::function<void()> task) -> void {
+        auto& p = periodic_.emplace_back();
+        p.interval = interval;
+        p.task = std::move(task);
+    }
+
+    /// Probe every target address, then linger to collect late replies.
+    /// @param targets addresses to probe
+    /// @param handler invoked with each captured packet
+    /// @param pending addresses to probe before the targets
+    template <TargetSource Targets, class Handler>
+        requires PacketSource<Source, Handler>
+    auto run(Targets& targets, Handler& handler, std::vector<uint32_t> pending = {}) -> void {
+        static constexpr auto congestion_interval = std::chrono::milliseconds{100};
+
+        TimerWheel::Timer finish;
+        TimerWheel::Timer save;
+        TimerWheel::Timer congestion;
+        auto done = false;
+
+        if (checkpoint_) {
+            wheel_.schedule(save, clock_.now() + checkpoint_interval_);
+        }
+        if constexpr (CongestionSource<Source>) {
+            wheel_.schedule(congestion, clock_.now() + congestion_interval);
+        }
+        for (auto& p : periodic_) {
+            wheel_.schedule(p, clock_.now() + p.interval);
+        }
+
+        auto expire = [&](TimerWheel::Timer& timer) {
+            if (&timer == &finish) {
+                done = true;
+            } else if (&timer == &save) {
+                auto outstanding = probeLogic_.outstanding();
+                outstanding.insert(outstanding.end(), pending.begin(), pending.end());
+                checkpoint_(targets.cursor(), outstanding);
+                wheel_.schedule(save, clock_.now() + checkpoint_interval_);
+            } else if (&timer == &congestion) {
+                if constexpr (CongestionSource<Source>) {
+                    probeLogic_.throttle(backpressure_.sample(source_.congested()));
+                    wheel_.schedule(congestion, clock_.now() + congestion_interval);
+                }
+            } else if (auto p = find_periodic(timer)) {
+                p->task();
+                wheel_.schedule(*p, clock_.now() + p->interval);
+            } else {
+                probeLogic_.expire(static_cast<Probe&>(timer), clock_.now());
+            }
+        };
+
+        while (!done) {
+            auto now = clock_.now();
+            while (!probeLogic_.full() && !pending.empty()) {
+                probeLogic_.launch(pending.back(), now);
+                pending.pop_back();
+            }
+            while (!probeLogic_.full() && !targets.empty()) {
+                probeLogic_.launch(targets.pop(), now);
+            }
+
+            // Linger after the last probe to collect late replies
+            if (targets.empty() && pending.empty() && probeLogic_.idle() && !finish.active()) {
+                wheel_.cancel(save);
+                wheel_.cancel(congestion);
+                for (auto& p : periodic_) {
+                    wheel_.cancel(p);
+                }
+                wheel_.schedule(finish, now + std::chrono::seconds{1});
+            }
+
+            int events;
+            {
+                Profile::Scope scope(Profile::wait);
+                events = source_.wait(wheel_.next_expiry());
+            }
+            NETSCAN_TRACE(loop_wakeup, events);
+            switch (events) {
+            case -1: {
+                Profile::Scope scope(Profile::reap);
+                probeLogic_.reap(clock_.now());
+                break;
+            }
+            case 1: {
+                Profile::Scope scope(Profile::dispatch);
+                source_.dispatch(handler);
+            }
+            }
+
+            wheel_.advance(clock_.now(), expire);
+        }
+    }
+};
+
+#endif /* ScanLoop_hpp */
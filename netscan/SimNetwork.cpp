@@ -0,0 +1,86 @@
+//
+//  SimNetwork.cpp
+//  netscan
+//
+
+#include "SimNetwork.hpp"
+
+#include <algorithm>
+
+SimNetwork::SimNetwork(SimClock& clock, Config config)
+  : clock_{clock}
+  , config_{config}
+  , rng_{config.seed}
+  , lost_{config.loss}
+  , jitter_{1.0 / std::max(1.0, static_cast<double>(config.jitter.count()))}
+  , next_pid_{1}
+  , stats_{}
+  , frame_{
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x01, // destination: the scanner
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x00, // source: 02:00 + IPv4 address
+        0x08, 0x00,                         // IPv4
+        0x45, 0x00}
+{}
+
+auto SimNetwork::is_live(uint32_t addr) const -> bool {
+    // splitmix64 finalizer gives a stable, well-mixed choice per address
+    auto x = config_.seed + addr + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<double>(x >> 11) * 0x1.0p-53 < config_.live;
+}
+
+auto SimNetwork::spawn(uint32_t addr) -> pid_t {
+    auto const pid = next_pid_++;
+    auto const now = clock_.now();
+    stats_.probes++;
+
+    if (is_live(addr) && !lost_(rng_)) {
+        auto const delay = config_.latency
+            + std::chrono::microseconds{static_cast<std::int64_t>(jitter_(rng_))};
+        auto const at = now + delay;
+        replies_.push({at, pid, addr, true});
+        // Late replies are still captured, but ping has already given up
+        if (delay < ping_timeout) {
+            completions_.push({at, pid, addr, true});
+            return pid;
+        }
+    }
+    completions_.push({now + ping_timeout, pid, addr, false});
+    return pid;
+}
+
+auto SimNetwork::reap() -> std::optional<std::pair<pid_t, bool>> {
+    if (completions_.empty() || clock_.now() < completions_.top().at) {
+        return {};
+    }
+    auto const event = completions_.top();
+    completions_.pop();
+    return {{event.pid, event.replied}};
+}
+
+auto SimNetwork::wait(std::optional<time_point> deadline) -> int {
+    std::optional<time_point> reply, completion;
+    if (!replies_.empty()) {
+        reply = replies_.top().at;
+    }
+    if (!completions_.empty()) {
+        completion = completions_.top().at;
+    }
+
+    // Replies are delivered before completions due at the same time, as
+    // a captured packet is seen before ping notices it.
+    if (reply && (!completion || *reply <= *completion) && (!deadline || *reply <= *deadline)) {
+        clock_.advance_to(*reply);
+        return 1;
+    }
+    if (completion && (!deadline || *completion <= *deadline)) {
+        clock_.advance_to(*completion);
+        return -1;
+    }
+    if (deadline) {
+        clock_.advance_to(*deadline);
+    }
+    return 0;
+}
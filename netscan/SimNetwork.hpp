@@ -0,0 +1,129 @@
+//
+//  SimNetwork.hpp
+//  netscan
+//
+
+#ifndef SimNetwork_hpp
+#define SimNetwork_hpp
+
+#include <sys/types.h>
+#include <pcap/pcap.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "TimerWheel.hpp"
+
+/// Virtual clock advanced by the simulation instead of by real time
+class SimClock {
+    TimerWheel::clock::time_point now_;
+public:
+    SimClock() : now_{} {}
+    auto now() const -> TimerWheel::clock::time_point { return now_; }
+    auto advance_to(TimerWheel::clock::time_point t) -> void { now_ = std::max(now_, t); }
+};
+
+/// Simulated network answering probes, usable as both the probe sender and
+/// the packet source of a ScanLoop.
+///
+/// Whether an address is live is a pure function of the address and seed,
+/// so retries see the same hosts. Each probe of a live host is lost with
+/// the configured probability, otherwise it is answered after a base
+/// latency plus exponentially distributed jitter. Probes behave like
+/// `ping -W1 -c1`: they complete on the reply or after one second.
+class SimNetwork {
+public:
+    struct Config {
+        double live = 0.5;     //!< fraction of addresses that answer
+        double loss = 0.01;    //!< probability a probe or reply is lost
+        std::chrono::microseconds latency {500};  //!< minimum round trip
+        std::chrono::microseconds jitter {2000};  //!< mean additional delay
+        std::uint64_t seed = 0;
+    };
+
+    struct Stats {
+        std::uint64_t probes;  //!< probes sent
+        std::uint64_t replies; //!< replies delivered
+    };
+
+private:
+    using time_point = TimerWheel::clock::time_point;
+    static constexpr auto ping_timeout = std::chrono::seconds{1};
+
+    struct Event {
+        time_point at;
+        pid_t pid;
+        uint32_t addr;
+        bool replied;
+        auto operator>(Event const& rhs) const -> bool { return at > rhs.at; }
+    };
+    using EventQueue = std::priority_queue<Event, std::vector<Event>, std::greater<>>;
+
+    SimClock& clock_;
+    Config config_;
+    std::mt19937_64 rng_;
+    std::bernoulli_distribution lost_;
+    std::exponential_distribution<double> jitter_;
+    EventQueue replies_;
+    EventQueue completions_;
+    pid_t next_pid_;
+    Stats stats_;
+    std::array<u_char, 16> frame_;
+
+    auto is_live(uint32_t addr) const -> bool;
+
+public:
+    SimNetwork(SimClock& clock, Config config);
+
+    /// @return true when the address would answer a probe at all
+    auto live(uint32_t addr) const -> bool { return is_live(addr); }
+
+    auto stats() const -> Stats { return stats_; }
+
+    // ProbeSender
+
+    auto spawn(uint32_t addr) -> pid_t;
+
+    /// Simulated probes always complete within the ping timeout
+    auto kill(pid_t) -> void {}
+
+    auto reap() -> std::optional<std::pair<pid_t, bool>>;
+
+    // PacketSource
+
+    /// Advance virtual time to the next event or the deadline
+    auto wait(std::optional<time_point> deadline) -> int;
+
+    /// Deliver all replies due by now as Ethernet headers whose source
+    /// address is derived from the replying IPv4 address.
+    template <class Handler>
+    auto dispatch(Handler& handler) -> void {
+        while (!replies_.empty() && replies_.top().at <= clock_.now()) {
+            auto const event = replies_.top();
+            replies_.pop();
+            stats_.replies++;
+
+            auto const us = std::chrono::duration_cast<std::chrono::microseconds>(event.at.time_since_epoch()).count();
+            pcap_pkthdr header {};
+            header.ts.tv_sec = static_cast<time_t>(us / 1'000'000);
+            header.ts.tv_usec = static_cast<suseconds_t>(us % 1'000'000);
+            header.caplen = frame_.size();
+            header.len = 98; // Ethernet + IPv4 + ICMP echo with 56 data bytes
+
+            frame_[8]  = static_cast<u_char>(event.addr >> 24);
+            frame_[9]  = static_cast<u_char>(event.addr >> 16);
+            frame_[10] = static_cast<u_char>(event.addr >> 8);
+            frame_[11] = static_cast<u_char>(event.addr);
+            handler(&header, static_cast<u_char const*>(frame_.data()));
+        }
+    }
+};
+
+#endif /* SimNetwork_hpp */
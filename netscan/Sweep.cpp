@@ -0,0 +1,128 @@
+//
+//  Sweep.cpp
+//  netscan
+//
+
+#include "Sweep.hpp"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "Interfaces.hpp"
+
+namespace {
+
+auto put16(u_char* p, uint16_t x) -> void {
+    p[0] = static_cast<u_char>(x >> 8);
+    p[1] = static_cast<u_char>(x);
+}
+
+auto put32(u_char* p, uint32_t x) -> void {
+    put16(p, static_cast<uint16_t>(x >> 16));
+    put16(p + 2, static_cast<uint16_t>(x));
+}
+
+auto put48(u_char* p, uint64_t x) -> void {
+    put16(p, static_cast<uint16_t>(x >> 32));
+    put32(p + 2, static_cast<uint32_t>(x));
+}
+
+/// Internet checksum of a byte range
+auto checksum(u_char const* p, std::size_t n) -> uint16_t {
+    uint32_t sum = 0;
+    for (std::size_t i = 0; i + 1 < n; i += 2) {
+        sum += uint32_t(p[i] << 8 | p[i + 1]);
+    }
+    if (n & 1) {
+        sum += uint32_t(p[n - 1] << 8);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+constexpr uint64_t broadcast_mac = 0xffff'ffff'ffff;
+
+auto ethernet(u_char* p, uint64_t src, uint16_t type, std::optional<uint16_t> vlan = {}) -> u_char* {
+    put48(p, broadcast_mac);
+    put48(p + 6, src);
+    p += 12;
+    if (vlan) {
+        put16(p, 0x8100);
+        put16(p + 2, *vlan & 0xfff);
+        p += 4;
+    }
+    put16(p, type);
+    return p + 2;
+}
+
+} // namespace
+
+Sweep::Sweep(std::string const& device)
+  : pcap_{Pcap::open_live(device.c_str(), 64, false, std::chrono::milliseconds{100})}
+  , mac_{InterfaceMac(device)}
+  , ipv4_{0}
+  , netmask_{0}
+  , sequence_{0}
+{
+    if (0 == mac_) {
+        throw std::runtime_error("no Ethernet address on " + device);
+    }
+    for (auto const& a : InterfaceAddresses()) {
+        if (a.device == device) {
+            ipv4_ = a.ipv4;
+            netmask_ = a.netmask;
+            break;
+        }
+    }
+    // Nothing is read from this handle, so keep its buffer empty
+    pcap_.setfilter(pcap_.compile("less 1", true, PCAP_NETMASK_UNKNOWN));
+}
+
+auto Sweep::echo(uint32_t broadcast) -> void {
+    if (0 == ipv4_) {
+        throw std::runtime_error("broadcast echo needs an IPv4 address on the device");
+    }
+    u_char frame[14 + 20 + 8 + sizeof(timeval)] {};
+    auto ip = ethernet(frame, mac_, 0x0800);
+
+    ip[0] = 0x45;
+    put16(ip + 2, sizeof frame - 14);
+    put16(ip + 4, sequence_);
+    ip[8] = 64;
+    ip[9] = 1; // ICMP
+    put32(ip + 12, ipv4_);
+    put32(ip + 16, broadcast);
+    put16(ip + 10, checksum(ip, 20));
+
+    auto icmp = ip + 20;
+    icmp[0] = 8; // echo request
+    put16(icmp + 4, static_cast<uint16_t>(getpid()));
+    put16(icmp + 6, sequence_++);
+    timeval now;
+    gettimeofday(&now, nullptr);
+    std::memcpy(icmp + 8, &now, sizeof now);
+    put16(icmp + 2, checksum(icmp, 8 + sizeof now));
+
+    pcap_.inject(frame, sizeof frame);
+}
+
+auto Sweep::arp(uint32_t target, std::optional<uint16_t> vlan) -> void {
+    u_char frame[18 + 28] {};
+    auto arp = ethernet(frame, mac_, 0x0806, vlan);
+    put16(arp, 1);          // Ethernet
+    put16(arp + 2, 0x0800); // IPv4
+    arp[4] = 6;
+    arp[5] = 4;
+    put16(arp + 6, 1);      // request
+    put48(arp + 8, mac_);
+    put32(arp + 14, vlan ? 0 : ipv4_);
+    put32(arp + 24, target);
+
+    pcap_.inject(frame, static_cast<std::size_t>(arp + 28 - frame));
+}
@@ -0,0 +1,50 @@
+//
+//  Sweep.hpp
+//  netscan
+//
+
+#ifndef Sweep_hpp
+#define Sweep_hpp
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "Pcap.hpp"
+
+/// Sends broadcast echo requests and ARP requests from an interface
+///
+/// Unlike a probe these are single injected frames, so a whole subnet can
+/// be asked in a burst. Frames go out on a handle of their own that never
+/// captures anything, keeping the capture handle to the capture thread.
+class Sweep final {
+    Pcap pcap_;
+    uint64_t mac_;
+    uint32_t ipv4_;    //!< 0 when the interface has no address
+    uint32_t netmask_;
+    uint16_t sequence_;
+
+public:
+    /// @param device Ethernet interface; a trunk port needs no IPv4 address
+    /// @exception std::runtime\_error when the device is unsuitable
+    explicit Sweep(std::string const& device);
+
+    /// @return true when addr is on the interface's subnet and can be ARPed
+    auto on_link(uint32_t addr) const -> bool {
+        return 0 != ipv4_ && (addr & netmask_) == (ipv4_ & netmask_);
+    }
+
+    /// Send an ICMP echo request to a broadcast address. It carries a
+    /// timestamp where ping puts one so replies get a round trip time.
+    /// @param broadcast destination address (host order)
+    /// @exception std::runtime\_error when the interface has no IPv4 address
+    auto echo(uint32_t broadcast) -> void;
+
+    /// Broadcast an ARP who-has request. On a VLAN it is an ARP probe with
+    /// a zero sender address, as the interface has no address there.
+    /// @param target address to resolve (host order)
+    /// @param vlan 802.1Q VLAN ID to tag the request with, if any
+    auto arp(uint32_t target, std::optional<uint16_t> vlan = {}) -> void;
+};
+
+#endif /* Sweep_hpp */
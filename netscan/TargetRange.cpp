@@ -0,0 +1,57 @@
+//
+//  TargetRange.cpp
+//  netscan
+//
+
+#include "TargetRange.hpp"
+
+#include <algorithm>
+
+#include "ExclusionSet.hpp"
+
+TargetRange::TargetRange(uint32_t first, uint32_t end, ExclusionSet const* exclude)
+  : next_{first}, end_{end}, exclude_{exclude}, block_{0}
+{
+    if (exclude_) {
+        block_ = exclude_->lower_bound(first);
+        skip();
+    }
+}
+
+auto TargetRange::skip() -> void {
+    if (exclude_ && block_ < exclude_->size() && exclude_->first(block_) <= next_) {
+        next_ = uint64_t{exclude_->last(block_)} + 1;
+        block_++;
+    }
+}
+
+auto TargetRange::pop() -> uint32_t {
+    auto addr = static_cast<uint32_t>(next_++);
+    skip();
+    return addr;
+}
+
+InterleavedTargets::InterleavedTargets(std::vector<TargetRange> ranges)
+  : ranges_{std::move(ranges)}, turn_{0}, end_{0}
+{
+    for (auto const& r : ranges_) {
+        end_ = std::max(end_, r.end());
+    }
+    ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(), [](auto const& r) {
+        return r.empty();
+    }), ranges_.end());
+}
+
+auto InterleavedTargets::pop() -> uint32_t {
+    auto& range = ranges_[turn_];
+    auto const addr = range.pop();
+    if (range.empty()) {
+        ranges_.erase(ranges_.begin() + static_cast<std::ptrdiff_t>(turn_));
+    } else {
+        turn_++;
+    }
+    if (turn_ >= ranges_.size()) {
+        turn_ = 0;
+    }
+    return addr;
+}
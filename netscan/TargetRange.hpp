@@ -0,0 +1,71 @@
+//
+//  TargetRange.hpp
+//  netscan
+//
+
+#ifndef TargetRange_hpp
+#define TargetRange_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ExclusionSet;
+
+/// Generator of the addresses to probe in a range
+///
+/// Excluded blocks are stepped over as a whole: the generator keeps its
+/// position in the exclusion list, so each block costs one comparison no
+/// matter how many addresses it covers.
+class TargetRange final {
+    uint64_t next_;
+    uint64_t end_;
+    ExclusionSet const* exclude_;
+    std::size_t block_;
+
+    auto skip() -> void;
+
+public:
+    /// @param first first address (host order)
+    /// @param end address after the last (host order)
+    /// @param exclude finalized set of addresses to skip, if any
+    TargetRange(uint32_t first, uint32_t end, ExclusionSet const* exclude = nullptr);
+
+    /// @return true when every address has been generated
+    auto empty() const -> bool { return next_ >= end_; }
+
+    /// @return the next address to probe; the range must not be empty
+    auto pop() -> uint32_t;
+
+    /// @return position from which the range can be resumed
+    auto cursor() const -> uint32_t { return static_cast<uint32_t>(next_ < end_ ? next_ : end_); }
+
+    /// @return address after the last (host order)
+    auto end() const -> uint32_t { return static_cast<uint32_t>(end_); }
+};
+
+/// Generator taking addresses from several ranges in turn
+///
+/// Under one concurrency limit, the ranges are probed side by side rather
+/// than each waiting for the ones before it to finish.
+class InterleavedTargets final {
+    std::vector<TargetRange> ranges_;
+    std::size_t turn_;
+    uint32_t end_;
+
+public:
+    /// @param ranges disjoint ranges in ascending order
+    explicit InterleavedTargets(std::vector<TargetRange> ranges);
+
+    /// @return true when every range is empty
+    auto empty() const -> bool { return ranges_.empty(); }
+
+    /// @return the next address of the range whose turn it is; must not be empty
+    auto pop() -> uint32_t;
+
+    /// @return lowest position of the unfinished ranges: resuming every
+    /// range from there repeats some probes but skips none
+    auto cursor() const -> uint32_t { return ranges_.empty() ? end_ : ranges_.front().cursor(); }
+};
+
+#endif /* TargetRange_hpp */
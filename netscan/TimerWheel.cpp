@@ -0,0 +1,126 @@
+//
+//  TimerWheel.cpp
+//  netscan
+//
+
+#include "TimerWheel.hpp"
+
+#include <algorithm>
+#include <bit>
+
+TimerWheel::TimerWheel(clock::duration resolution, clock::time_point start)
+  : epoch_{start}, resolution_{resolution}, now_{0}, count_{0}, occupied_{}
+{
+    for (auto& bucket : buckets_) {
+        bucket.next = bucket.prev = &bucket;
+    }
+}
+
+auto TimerWheel::to_tick(clock::time_point t) const -> std::uint64_t {
+    if (t <= epoch_) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>((t - epoch_) / resolution_);
+}
+
+auto TimerWheel::schedule(Timer& timer, clock::time_point when) -> void {
+    cancel(timer);
+
+    // Round up so that timers never fire early, and never into the
+    // tick that has already been processed.
+    auto tick = to_tick(when);
+    if (epoch_ + tick * resolution_ < when) {
+        tick++;
+    }
+    timer.expiry_ = std::clamp(tick, now_ + 1, now_ + max_delta);
+
+    insert(timer);
+    count_++;
+}
+
+auto TimerWheel::cancel(Timer& timer) -> void {
+    if (timer.active()) {
+        unlink(timer);
+        count_--;
+    }
+}
+
+auto TimerWheel::insert(Timer& timer) -> void {
+    auto const delta = timer.expiry_ - now_;
+    unsigned level = 0;
+    while (level + 1 < levels && delta >> (slot_bits * (level + 1))) {
+        level++;
+    }
+    auto const index = (timer.expiry_ >> (slot_bits * level)) & (slots - 1);
+    timer.slot_ = static_cast<std::uint16_t>(level * slots + index);
+
+    auto& head = buckets_[timer.slot_];
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+    occupied_[level] |= std::uint64_t{1} << index;
+}
+
+auto TimerWheel::unlink(Timer& timer) -> void {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.next = timer.prev = nullptr;
+
+    auto& head = buckets_[timer.slot_];
+    if (head.next == &head) {
+        occupied_[timer.slot_ / slots] &= ~(std::uint64_t{1} << (timer.slot_ % slots));
+    }
+}
+
+auto TimerWheel::cascade(unsigned level) -> unsigned {
+    auto const index = static_cast<unsigned>((now_ >> (slot_bits * level)) & (slots - 1));
+    auto& head = buckets_[level * slots + index];
+
+    // Detach the whole list first; reinsertion always lands on a lower level.
+    auto link = head.next;
+    head.next = head.prev = &head;
+    occupied_[level] &= ~(std::uint64_t{1} << index);
+
+    while (link != &head) {
+        auto timer = static_cast<Timer*>(link);
+        link = link->next;
+        insert(*timer);
+    }
+    return index;
+}
+
+auto TimerWheel::expire_slot() -> Timer* {
+    auto& head = buckets_[now_ & (slots - 1)];
+    if (head.next == &head) {
+        return nullptr;
+    }
+    auto timer = static_cast<Timer*>(head.next);
+    unlink(*timer);
+    count_--;
+    return timer;
+}
+
+auto TimerWheel::next_expiry() const -> std::optional<clock::time_point> {
+    if (empty()) {
+        return {};
+    }
+
+    // Next cascade boundary, needed whenever upper levels hold timers
+    auto tick = ((now_ >> slot_bits) + 1) << slot_bits;
+    bool upper = false;
+    for (unsigned level = 1; level < levels; level++) {
+        upper |= 0 != occupied_[level];
+    }
+    if (!upper) {
+        tick = now_ + slots;
+    }
+
+    if (auto const bits = occupied_[0]) {
+        auto const start = static_cast<int>((now_ + 1) & (slots - 1));
+        auto const offset = std::countr_zero(std::rotr(bits, start));
+        tick = std::min(tick, now_ + 1 + offset);
+    }
+
+    return epoch_ + tick * resolution_;
+}
@@ -0,0 +1,117 @@
+//
+//  TimerWheel.hpp
+//  netscan
+//
+
+#ifndef TimerWheel_hpp
+#define TimerWheel_hpp
+
+#include <array>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+
+/// Hierarchical timing wheel with intrusive timers
+///
+/// Timers are embedded in their owners, so scheduling never allocates.
+/// Scheduling, cancellation, and expiry are O(1); timers further than one
+/// wheel turn away are cascaded down a level as time advances.
+class TimerWheel final {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    static constexpr unsigned slot_bits = 6;
+    static constexpr unsigned slots = 1U << slot_bits;
+    static constexpr unsigned levels = 4;
+    static constexpr std::uint64_t max_delta = (std::uint64_t{1} << (slot_bits * levels)) - 1;
+
+    struct Link {
+        Link* next;
+        Link* prev;
+    };
+
+public:
+    /// A schedulable event, intended to be embedded in (or inherited by)
+    /// the object it times. A timer must be cancelled before it is destroyed.
+    class Timer : Link {
+        friend TimerWheel;
+        std::uint64_t expiry_;
+        std::uint16_t slot_;
+    public:
+        Timer() noexcept : Link{nullptr, nullptr}, expiry_{}, slot_{} {}
+        Timer(Timer const&) = delete;
+        auto operator=(Timer const&) -> Timer& = delete;
+
+        /// @return true when the timer is scheduled on a wheel
+        auto active() const noexcept -> bool { return nullptr != next; }
+    };
+
+private:
+    clock::time_point epoch_;
+    clock::duration resolution_;
+    std::uint64_t now_;
+    std::size_t count_;
+    std::array<std::uint64_t, levels> occupied_;
+    std::array<Link, slots * levels> buckets_;
+
+    auto to_tick(clock::time_point t) const -> std::uint64_t;
+    auto insert(Timer& timer) -> void;
+    auto unlink(Timer& timer) -> void;
+    auto cascade(unsigned level) -> unsigned;
+    auto expire_slot() -> Timer*;
+
+public:
+    /// Construct an empty wheel
+    /// @param resolution duration of a single tick
+    /// @param start time corresponding to tick zero
+    explicit TimerWheel(clock::duration resolution, clock::time_point start = clock::now());
+    TimerWheel(TimerWheel const&) = delete;
+    auto operator=(TimerWheel const&) -> TimerWheel& = delete;
+
+    /// Schedule a timer, rescheduling it if it is already active
+    /// @param timer timer to schedule
+    /// @param when expiration time, rounded up to the next tick
+    auto schedule(Timer& timer, clock::time_point when) -> void;
+
+    /// Remove a timer from the wheel if it is active
+    /// @param timer timer to cancel
+    auto cancel(Timer& timer) -> void;
+
+    /// @return number of active timers
+    auto size() const noexcept -> std::size_t { return count_; }
+
+    /// @return true when no timers are active
+    auto empty() const noexcept -> bool { return 0 == count_; }
+
+    /// Earliest time at which advance might have work to do. This may be
+    /// earlier than the next expiration when higher levels need cascading.
+    /// @return wakeup time or empty when no timers are active
+    auto next_expiry() const -> std::optional<clock::time_point>;
+
+    /// Advance the wheel, invoking callback for each expired timer.
+    /// Expired timers are inactive when the callback runs and may be
+    /// rescheduled from it.
+    /// @param now current time
+    /// @param callback invoked with each expired timer
+    template <std::invocable<Timer&> Callback>
+    auto advance(clock::time_point now, Callback&& callback) -> void {
+        auto const target = to_tick(now);
+        while (now_ < target) {
+            if (empty()) {
+                now_ = target;
+                return;
+            }
+            now_++;
+            if (0 == (now_ & (slots - 1))) {
+                for (unsigned level = 1; level < levels && 0 == cascade(level); level++) {}
+            }
+            while (auto timer = expire_slot()) {
+                callback(*timer);
+            }
+        }
+    }
+};
+
+#endif /* TimerWheel_hpp */
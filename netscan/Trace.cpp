@@ -0,0 +1,35 @@
+//
+//  Trace.cpp
+//  netscan
+//
+
+#include "Trace.hpp"
+
+#include <fmt/format.h>
+
+auto Profile::report(std::ostream& out) -> void {
+    if (!enabled_) {
+        return;
+    }
+
+    static constexpr char const* phase_names[phases] {"spawn", "reap", "wait", "dispatch", "  output"};
+    static constexpr char const* event_names[events] {"reply", "dedup hit", "dedup miss"};
+
+    using ms = std::chrono::duration<double, std::milli>;
+    using us = std::chrono::duration<double, std::micro>;
+    auto const elapsed = ms{clock::now() - start_};
+
+    out << fmt::format("{:<12}{:>12}{:>12}{:>10}{:>8}\n", "phase", "calls", "total ms", "mean us", "share");
+    for (unsigned i = 0; i < phases; i++) {
+        auto const& total = phases_[i];
+        auto const mean = total.calls ? us{total.time}.count() / double(total.calls) : 0.0;
+        auto const share = elapsed.count() > 0 ? 100 * ms{total.time}.count() / elapsed.count() : 0.0;
+        out << fmt::format("{:<12}{:>12}{:>12.1f}{:>10.1f}{:>7.1f}%\n",
+            phase_names[i], total.calls, ms{total.time}.count(), mean, share);
+    }
+    out << fmt::format("{:<12}{:>12}{:>12.1f}\n", "elapsed", "", elapsed.count());
+    for (unsigned i = 0; i < events; i++) {
+        out << fmt::format("{:<12}{:>12}\n", event_names[i], events_[i].load(std::memory_order_relaxed));
+    }
+    out.flush();
+}
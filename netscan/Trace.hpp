@@ -0,0 +1,97 @@
+//
+//  Trace.hpp
+//  netscan
+//
+
+#ifndef Trace_hpp
+#define Trace_hpp
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/// @def NETSCAN_TRACE(name, ...)
+/// Static tracepoint in the `netscan` provider. With systemtap's sys/sdt.h
+/// this is a single nop plus an ELF note until perf or bpftrace attach,
+/// e.g. `bpftrace -e 'usdt:./netscan:netscan:probe_send { @[arg0] = count(); }'`.
+/// Elsewhere it expands to nothing and its arguments are not evaluated.
+#if defined(__linux__) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define NETSCAN_TRACE(name, ...) STAP_PROBEV(netscan, name __VA_OPT__(,) __VA_ARGS__)
+#else
+#define NETSCAN_TRACE(name, ...) ((void)0)
+#endif
+
+/// Built-in breakdown of where a scan spends its time
+///
+/// Collection is off unless enable() is called; disabled scopes cost a
+/// predictable branch. Phase timings are only recorded from the scan
+/// thread, event counts from any thread.
+class Profile final {
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum Phase : unsigned {
+        spawn,    //!< launching probe processes
+        reap,     //!< collecting finished probes
+        wait,     //!< blocked waiting for replies, completions or timers
+        dispatch, //!< draining captured replies, including output
+        output,   //!< formatting and writing new hosts
+        phases
+    };
+
+    enum Event : unsigned {
+        reply,      //!< frame queued by the capture thread
+        dedup_hit,  //!< reply from an address already reported
+        dedup_miss, //!< reply from a new address
+        events
+    };
+
+private:
+    struct Total {
+        std::uint64_t calls;
+        clock::duration time;
+    };
+    static inline bool enabled_ = false;
+    static inline clock::time_point start_;
+    static inline std::array<Total, phases> phases_ {};
+    static inline std::array<std::atomic<std::uint64_t>, events> events_ {};
+
+public:
+    /// Time the enclosing block as one call of a phase
+    class Scope final {
+        Phase phase_;
+        clock::time_point start_;
+    public:
+        explicit Scope(Phase phase) : phase_{phase}, start_{enabled_ ? clock::now() : clock::time_point{}} {}
+        ~Scope() {
+            if (enabled_) {
+                auto& total = phases_[phase_];
+                total.calls++;
+                total.time += clock::now() - start_;
+            }
+        }
+        Scope(Scope const&) = delete;
+        auto operator=(Scope const&) -> Scope& = delete;
+    };
+
+    /// Start collecting. Call before starting any other threads.
+    static auto enable() -> void {
+        enabled_ = true;
+        start_ = clock::now();
+    }
+
+    static auto count(Event event) -> void {
+        if (enabled_) {
+            events_[event].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// Write a table of phase times and event counts since enable()
+    /// @param out stream to write to
+    static auto report(std::ostream& out) -> void;
+};
+
+#endif /* Trace_hpp */
@@ -15,28 +15,51 @@
 #include <poll.h> // poll
 #include <unistd.h> // STDOUT_FILENO STDIN_FILENO
 #include <fcntl.h>
+#include <net/if.h> // if_nametoindex
 
 #include <sys/select.h>
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
 #include <cstdlib>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <system_error>
 #include <tuple>
-#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/program_options.hpp>
 #include <fmt/format.h>
 #include <pcap/pcap.h>
 
+#include "CaptureThread.hpp"
+#include "Checkpoint.hpp"
+#include "Cluster.hpp"
+#include "ExclusionSet.hpp"
+#include "Interfaces.hpp"
+#include "Ipv4Argument.hpp"
 #include "MyLibC.hpp"
+#include "OuiTable.hpp"
+#include "PacketLogic.hpp"
+#include "PcapDumper.hpp"
 #include "Pcap.hpp"
 #include "PosixSpawn.hpp"
 #include "PosixSpawnFileActions.hpp"
 #include "PosixSpawnAttr.hpp"
+#include "ResultRing.hpp"
+#include "ReverseDns.hpp"
+#include "Rtnetlink.hpp"
+#include "ScanLoop.hpp"
+#include "Sweep.hpp"
+#include "TargetRange.hpp"
+#include "Trace.hpp"
 
 using namespace std::chrono_literals;
 namespace ch = std::chrono;
@@ -45,35 +68,56 @@ namespace {
 
 /// Construct a ping reply listener
 /// @param device name to listen on
-auto pcap_setup(std::string const& device) -> Pcap
+/// @param passive listen to all traffic with a unicast source instead
+/// @param arp also listen to ARP replies
+/// @param vlan listen only to ARP replies with one or two VLAN tags instead
+auto pcap_setup(std::string const& device, bool passive, bool arp, bool vlan) -> Pcap
 {
-    auto p = Pcap::open_live(device.c_str(), 16, 0, 100ms);
-    auto filter = "icmp[icmptype] == icmp-echoreply";
+    // Active scans keep enough of each echo reply to recover ping's timestamp
+    auto p = Pcap::open_live(device.c_str(), passive ? 38 : 64, passive, 100ms);
+    // Every well-formed frame (ARP, DHCP, ND, ...) has a unicast source
+    // Each vlan keyword moves later offsets past one tag; Q-in-Q needs two
+    auto filter = passive ? "ether[6] & 1 == 0"
+                : vlan ? "vlan and (arp[6:2] == 2 or (vlan and arp[6:2] == 2))"
+                : arp ? "icmp[icmptype] == icmp-echoreply or arp[6:2] == 2"
+                : "icmp[icmptype] == icmp-echoreply";
     p.setfilter(p.compile(filter, true, PCAP_NETMASK_UNKNOWN));
     return p;
 }
 
-struct ipv4_argument {
-    in_addr_t value;
-};
-
-// Used by boost::program_options internally
-auto validate(boost::any& v, std::vector<std::string> const& values, ipv4_argument*, int) -> void {
-    namespace po = boost::program_options;
-    po::validators::check_first_occurrence(v);
-    auto const& s = po::validators::get_single_string(values);
-    if (auto a = InAddrPton(s.c_str())) {
-        v = boost::any(ipv4_argument{*a});
-    } else {
-        throw po::validation_error(po::validation_error::invalid_option_value);
-    }
-}
-
 struct options {
     int spawn_limit;
+    int retries;
     std::string device;
     ipv4_argument network;
     ipv4_argument netmask;
+    std::string oui;
+    bool passive;
+    std::string checkpoint;
+    int checkpoint_interval;
+    bool resume;
+    std::string ring;
+    std::size_t ring_size;
+    bool quiet;
+    bool neighbours;
+    std::vector<std::string> excludes;
+    std::vector<std::string> exclude_files;
+    bool worker;
+    std::string listen;
+    bool coordinate;
+    std::vector<std::string> workers;
+    std::vector<std::string> targets;
+    int shard_prefix;
+    std::vector<int> capture_cpus;
+    bool profile;
+    bool resolve;
+    std::string dns_server;
+    bool presweep;
+    std::vector<std::string> vlans;
+    std::string write_pcap;
+    std::uint64_t pcap_rotate;
+    bool auto_scan;
+    int auto_prefix;
 };
 
 auto get_options(int argc, char** argv) -> options {
@@ -84,9 +128,37 @@ auto get_options(int argc, char** argv) -> options {
     desc.add_options()
         ("help", "produce help message")
         ("limit,l", po::value(&o.spawn_limit)->default_value(50), "concurrent process spawn limit")
-        ("device",  po::value(&o.device)->required(), "libpcap capture device")
-        ("network", po::value(&o.network)->required(), "network number")
-        ("netmask", po::value(&o.netmask)->required(), "network mask");
+        ("retries,r", po::value(&o.retries)->default_value(0), "additional probes for unresponsive addresses")
+        ("device",  po::value(&o.device), "libpcap capture device")
+        ("network", po::value(&o.network), "network number")
+        ("netmask", po::value(&o.netmask), "network mask")
+        ("oui", po::value(&o.oui), "vendor table built by netscan-oui")
+        ("passive", po::bool_switch(&o.passive), "report hosts, and each new IPv4 address of a host (up to about a million pairs), seen on the wire without probing")
+        ("checkpoint", po::value(&o.checkpoint), "file to periodically save scan progress to")
+        ("checkpoint-interval", po::value(&o.checkpoint_interval)->default_value(10), "seconds between checkpoints")
+        ("resume", po::bool_switch(&o.resume), "continue the scan saved in the checkpoint file")
+        ("ring", po::value(&o.ring), "shared memory result ring file to publish hosts to")
+        ("ring-size", po::value(&o.ring_size)->default_value(65536), "result ring capacity in records")
+        ("quiet,q", po::bool_switch(&o.quiet), "do not print hosts to stdout")
+        ("neighbours", po::bool_switch(&o.neighbours), "merge in the kernel neighbour table during and after the scan (Linux)")
+        ("exclude", po::value(&o.excludes)->composing(), "address or CIDR block never to probe")
+        ("exclude-file", po::value(&o.exclude_files)->composing(), "file of addresses or CIDR blocks never to probe")
+        ("worker", po::bool_switch(&o.worker), "scan shards assigned by a coordinator")
+        ("listen", po::value(&o.listen), "worker endpoint to accept a coordinator on (unix:PATH or HOST:PORT)")
+        ("coordinate", po::bool_switch(&o.coordinate), "distribute targets to workers and merge their results")
+        ("workers", po::value(&o.workers)->composing(), "worker endpoint to connect to (unix:PATH or HOST:PORT)")
+        ("target", po::value(&o.targets)->composing(), "CIDR block for the coordinator to distribute")
+        ("shard-prefix", po::value(&o.shard_prefix)->default_value(24), "prefix length of each distributed shard")
+        ("capture-cpu", po::value(&o.capture_cpus)->composing(), "processor to pin a capture thread to; with --auto give one per device, in order of their lowest subnet, -1 for none (Linux)")
+        ("profile", po::bool_switch(&o.profile), "print a breakdown of time spent per scan phase to stderr")
+        ("resolve", po::bool_switch(&o.resolve), "print each host's reverse DNS name, looked up in the background")
+        ("dns-server", po::value(&o.dns_server), "DNS server for --resolve as ADDRESS[:PORT] instead of resolv.conf")
+        ("presweep", po::bool_switch(&o.presweep), "find hosts with a broadcast echo and ARP requests first, then ping only the silent addresses")
+        ("vlan", po::value(&o.vlans)->composing(), "VLAN-ID:CIDR to scan with tagged ARP requests through a trunk device")
+        ("write-pcap", po::value(&o.write_pcap), "savefile to keep every accepted reply in")
+        ("pcap-rotate", po::value(&o.pcap_rotate)->default_value(0), "start a new savefile (PATH.0, PATH.1, ...) every this many MiB, 0 for never")
+        ("auto", po::bool_switch(&o.auto_scan), "scan every subnet attached to an Ethernet interface, or only to the device when given")
+        ("auto-prefix", po::value(&o.auto_prefix)->default_value(16), "shortest prefix length --auto will scan; larger subnets are skipped");
 
     po::positional_options_description p;
     p.add("device", 1).add("network", 1).add("netmask", 1);
@@ -101,6 +173,43 @@ auto get_options(int argc, char** argv) -> options {
 
     po::notify(vm);
 
+    auto require = [&vm](std::initializer_list<char const*> names) {
+        for (auto name : names) {
+            if (0 == vm.count(name)) {
+                throw po::required_option(name);
+            }
+        }
+    };
+
+    if (o.auto_scan) {
+        if (o.coordinate || o.worker || o.passive || !o.vlans.empty()) {
+            throw po::error("--auto cannot be combined with --coordinate, --worker, --passive or --vlan");
+        }
+        if (vm.count("network") || vm.count("netmask")) {
+            throw po::error("--auto finds the networks itself and takes no network or netmask");
+        }
+    } else if (o.coordinate) {
+        require({"workers", "target"});
+    } else {
+        require({"device"});
+        if (o.worker) {
+            require({"listen"});
+        } else if (!o.passive && o.vlans.empty()) {
+            require({"network", "netmask"});
+        }
+    }
+
+    if (!o.vlans.empty() && (o.presweep || !o.checkpoint.empty() || o.resume)) {
+        throw po::error("--vlan cannot be combined with --presweep, --checkpoint or --resume");
+    }
+
+    if (o.resume && o.checkpoint.empty()) {
+        throw po::required_option("checkpoint");
+    }
+    if (o.checkpoint_interval < 1) {
+        throw po::error("--checkpoint-interval must be at least 1 second");
+    }
+
     return o;
 }
 
@@ -108,23 +217,6 @@ auto set_cloexec(int fd) -> void {
     FcntlSetFd(fd, FD_CLOEXEC |  FcntlGetFd(fd));
 }
 
-// Logic to be applied to each of the packets
-class PacketLogic {
-    std::unordered_set<std::string> macs_;
-public:
-    auto operator()(auto pkt_header, auto pkt_data) -> void {
-        if (11 < pkt_header->caplen) {
-            auto mac = fmt::format(
-               "{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
-               pkt_data[ 6], pkt_data[ 7], pkt_data[ 8],
-               pkt_data[ 9], pkt_data[10], pkt_data[11]);
-            if (macs_.insert(mac).second) {
-                std::cout << mac << std::endl;
-            }
-        }
-    }
-};
-
 class SpawnLogic {
     PosixSpawnAttr attr_;
     PosixSpawnFileActions actions_;
@@ -139,10 +231,23 @@ public:
         actions_.addopen(STDOUT_FILENO, "/dev/null", O_WRONLY);
     }
 
-    auto spawn(uint32_t addr) -> void {
+    auto spawn(uint32_t addr) -> pid_t {
         auto arg = std::to_string(addr);
         args_[3] = arg.data(); // null-terminated since C++11
-        PosixSpawnp("ping", actions_, attr_, args_, nullptr);
+        return PosixSpawnp("ping", actions_, attr_, args_, nullptr);
+    }
+
+    auto kill(pid_t pid) -> void {
+        Kill(pid, SIGKILL);
+    }
+
+    /// Collect a terminated ping; it exits successfully on a reply
+    auto reap() -> std::optional<std::pair<pid_t, bool>> {
+        auto [pid, status] = Wait(-1, WNOHANG);
+        if (0 == pid) {
+            return {};
+        }
+        return {{pid, WIFEXITED(status) && 0 == WEXITSTATUS(status)}};
     }
 };
 
@@ -152,7 +257,6 @@ class SelectLogic {
     fd_set readfds_;
     sigset_t chldmask_;
     sigset_t nochldmask_;
-    std::optional<ch::steady_clock::time_point> cutoff_;
 
     template <class Rep, class Period>
     static auto to_timespec(ch::duration<Rep, Period> duration) -> timespec {
@@ -162,24 +266,14 @@ class SelectLogic {
         return result;
     }
 
-    auto timeout(bool hasKids) -> std::optional<timespec> {
-        if (hasKids) {
-            return {};
-        }
-        auto now = ch::steady_clock::now();
-        if (cutoff_) {
-            return to_timespec(std::max(decltype(now)::duration::zero(), *cutoff_ - now));
-        }
-        cutoff_ = now + 1s;
-        return to_timespec(1s);
-    }
-
 public:
-    SelectLogic(int pcap_fd) {
-        nfds_ = pcap_fd + 1;
-
+    SelectLogic(std::vector<int> const& fds) {
+        nfds_ = 0;
         FD_ZERO(&readfds_);
-        FD_SET(pcap_fd, &readfds_);
+        for (auto fd : fds) {
+            nfds_ = std::max(nfds_, fd + 1);
+            FD_SET(fd, &readfds_);
+        }
 
         sigemptyset(&chldmask_);
         sigaddset(&chldmask_, SIGCHLD);
@@ -191,14 +285,389 @@ public:
         Sigaction(SIGCHLD, {[](int){}});
     }
 
-    auto wait(bool hasKids) {
+    /// Wait for packets, a child process to terminate, or a deadline
+    /// @param deadline time to stop waiting or empty for indefinite
+    auto wait(std::optional<ch::steady_clock::time_point> deadline) {
         fd_set fds;
         FD_COPY(&readfds_, &fds);
-        auto to = timeout(hasKids);
+        std::optional<timespec> to;
+        if (deadline) {
+            auto now = ch::steady_clock::now();
+            to = to_timespec(std::max(decltype(now)::duration::zero(), *deadline - now));
+        }
         return pselect(nfds_, &fds, nullptr, nullptr, to ? &*to : nullptr, &nochldmask_);
     }
+
+    /// Check for a terminated child without waiting. pselect returns
+    /// ready descriptors without delivering a pending SIGCHLD, so callers
+    /// that skip the wait while work is queued must ask here instead.
+    /// @return true when SIGCHLD was pending; it is consumed
+    auto child_exited() -> bool {
+        sigset_t pending;
+        sigpending(&pending);
+        if (!sigismember(&pending, SIGCHLD)) {
+            return false;
+        }
+        Sigprocmask(SIG_UNBLOCK, chldmask_);
+        Sigprocmask(SIG_BLOCK, chldmask_);
+        return true;
+    }
+};
+
+// Live captures multiplexed with ping termination
+class CaptureLogic {
+    static constexpr std::size_t queue_capacity = 4096;
+    // Draining this much at once means replies are queueing faster than we process them
+    static constexpr std::size_t backlog_threshold = 1024;
+
+    std::vector<std::unique_ptr<CaptureThread>> captures_;
+    SelectLogic selectLogic_;
+    uint64_t lost_;
+    bool backlogged_;
+
+    static auto start(std::vector<Pcap*> const& pcaps, std::vector<int> const& cpus) -> std::vector<std::unique_ptr<CaptureThread>> {
+        std::vector<std::unique_ptr<CaptureThread>> captures;
+        for (std::size_t i = 0; i < pcaps.size(); i++) {
+            auto const cpu = i < cpus.size() && 0 <= cpus[i] ? std::optional{cpus[i]} : std::nullopt;
+            captures.push_back(std::make_unique<CaptureThread>(*pcaps[i], queue_capacity, cpu));
+        }
+        return captures;
+    }
+
+    static auto fds(std::vector<std::unique_ptr<CaptureThread>> const& captures) -> std::vector<int> {
+        std::vector<int> result;
+        for (auto const& capture : captures) {
+            result.push_back(capture->fd());
+        }
+        return result;
+    }
+
+public:
+    /// @param pcaps captures to drain, each on a dedicated thread
+    /// @param cpus processor to pin each capture's thread to; threads past
+    /// the end of the list or given a negative one are not pinned
+    CaptureLogic(std::vector<Pcap*> const& pcaps, std::vector<int> const& cpus)
+      : captures_{start(pcaps, cpus)}
+      , selectLogic_{fds(captures_)}
+      , lost_{0}
+      , backlogged_{false}
+    {}
+
+    CaptureLogic(Pcap& pcap, std::vector<int> const& cpus) : CaptureLogic(std::vector<Pcap*>{&pcap}, cpus) {}
+
+    auto wait(std::optional<ch::steady_clock::time_point> deadline) {
+        for (auto const& capture : captures_) {
+            if (capture->arm()) {
+                // A steady stream of replies must not keep finished pings
+                // from being reaped
+                return selectLogic_.child_exited() ? -1 : 1;
+            }
+        }
+        // Several captures can be ready at once; the scan loop expects 1
+        auto const events = selectLogic_.wait(deadline);
+        return 0 < events ? 1 : events;
+    }
+
+    template <class Handler>
+    auto dispatch(Handler& handler) -> void {
+        for (auto const& capture : captures_) {
+            if (capture->dispatch(handler) >= backlog_threshold) {
+                backlogged_ = true;
+            }
+        }
+    }
+
+    /// @return true when packets were lost or backlogged since the last call
+    auto congested() -> bool {
+        uint64_t lost = 0;
+        auto result = backlogged_;
+        for (auto const& capture : captures_) {
+            lost += capture->lost();
+            result = capture->backlogged() || result;
+        }
+        result = result || lost != lost_;
+        lost_ = lost;
+        backlogged_ = false;
+        return result;
+    }
+};
+
+/// Handle replies until a deadline
+template <class Handler>
+auto collect(CaptureLogic& captureLogic, Handler& handler, ch::steady_clock::time_point until) -> void {
+    while (ch::steady_clock::now() < until) {
+        if (0 < captureLogic.wait(until)) {
+            captureLogic.dispatch(handler);
+        }
+    }
+}
+
+/// Send injected requests in paced batches, handling replies in between
+/// @param targets addresses to consider
+/// @param send sends a request to an address, returning false if it chose not to
+template <class Send, class Handler>
+auto paced_sweep(TargetRange& targets, Send send, CaptureLogic& captureLogic, Handler& handler) -> void {
+    // Paced so the transmit queue keeps up: about 25,000 requests a second
+    static constexpr std::size_t batch = 256;
+    static constexpr auto batch_interval = 10ms;
+
+    while (!targets.empty()) {
+        auto const deadline = ch::steady_clock::now() + batch_interval;
+        for (std::size_t sent = 0; sent < batch && !targets.empty();) {
+            sent += send(targets.pop());
+        }
+        collect(captureLogic, handler, deadline);
+    }
+}
+
+/// Find the hosts that answer a broadcast echo or an ARP request, so that
+/// only the silent addresses need a ping each
+/// @param device Ethernet interface to send from
+/// @param first first address to sweep (host order)
+/// @param end address after the last, also the broadcast address (host order)
+/// @param exclude addresses never to send to
+/// @param captureLogic source of replies
+/// @param packetLogic reports each reply as usual
+/// @return exclude plus every address that answered
+auto presweep(std::string const& device, uint32_t first, uint32_t end, ExclusionSet const& exclude, CaptureLogic& captureLogic, PacketLogic& packetLogic) -> ExclusionSet {
+    static constexpr auto linger = 1s;
+
+    // Point-to-point links and resumed scans past the end have nothing to sweep
+    if (first >= end) {
+        return exclude;
+    }
+
+    Sweep sweep(device);
+    std::vector<bool> answered(end - first);
+    auto handler = [&](pcap_pkthdr const* header, u_char const* data) {
+        packetLogic(header, data);
+        auto const l2 = PacketLogic::link(header, data);
+        if (!l2) {
+            return;
+        }
+        if (auto ipv4 = PacketLogic::source_ipv4(header, data, *l2); ipv4 && first <= *ipv4 && *ipv4 < end) {
+            answered[*ipv4 - first] = true;
+        }
+    };
+
+    if (!exclude.contains(end)) {
+        sweep.echo(end);
+    }
+    TargetRange targets(first, end, &exclude);
+    paced_sweep(targets, [&](uint32_t addr) {
+        if (!sweep.on_link(addr)) {
+            return false;
+        }
+        sweep.arp(addr);
+        return true;
+    }, captureLogic, handler);
+    collect(captureLogic, handler, ch::steady_clock::now() + linger);
+
+    ExclusionSet skip = exclude;
+    for (std::size_t i = 0; i < answered.size(); i++) {
+        if (answered[i]) {
+            auto j = i;
+            while (j + 1 < answered.size() && answered[j + 1]) {
+                j++;
+            }
+            skip.add(first + static_cast<uint32_t>(i), first + static_cast<uint32_t>(j));
+            i = j;
+        }
+    }
+    skip.finalize();
+    return skip;
+}
+
+/// A subnet to scan on a VLAN
+struct VlanTarget {
+    uint16_t vlan;
+    uint32_t first; //!< host order
+    uint32_t end;   //!< address after the last (host order)
+    std::vector<bool> answered;
+};
+
+/// Parse VLAN-ID:CIDR, e.g. 120:10.12.0.0/22
+auto parse_vlan(std::string const& text) -> VlanTarget {
+    auto const invalid = std::runtime_error("invalid VLAN target: " + text);
+    auto const colon = text.find(':');
+    if (std::string::npos == colon) {
+        throw invalid;
+    }
+
+    int vlan = 0;
+    std::size_t used = 0;
+    try {
+        vlan = std::stoi(text.substr(0, colon), &used);
+    } catch (std::exception const&) {
+        throw invalid;
+    }
+    if (used != colon || vlan < 1 || vlan > 4094) {
+        throw invalid;
+    }
+
+    // Reuse the exclusion parser for the block
+    ExclusionSet block;
+    block.add(std::string_view(text).substr(colon + 1));
+    block.finalize();
+    auto first = uint64_t{block.first(0)};
+    auto end = uint64_t{block.last(0)} + 1;
+    if (4 <= end - first) {
+        first++;
+        end--;
+    }
+    return {static_cast<uint16_t>(vlan), static_cast<uint32_t>(first), static_cast<uint32_t>(end),
+            std::vector<bool>(end - first)};
+}
+
+/// Scan subnets on several VLANs of a trunk port. Each address gets a
+/// tagged ARP request, repeated for those that stay silent, and replies
+/// are attributed to VLANs by their tags.
+/// @param o command line options
+/// @param exclude addresses never to send to, on any VLAN
+/// @param captureLogic source of tagged ARP replies
+/// @param packetLogic reports each reply
+auto scan_vlans(options const& o, ExclusionSet const& exclude, CaptureLogic& captureLogic, PacketLogic& packetLogic) -> void {
+    static constexpr auto linger = 1s;
+
+    std::vector<VlanTarget> vlans;
+    for (auto const& text : o.vlans) {
+        vlans.push_back(parse_vlan(text));
+    }
+
+    Sweep sweep(o.device);
+    auto handler = [&](pcap_pkthdr const* header, u_char const* data) {
+        packetLogic(header, data);
+        auto const l2 = PacketLogic::link(header, data);
+        if (!l2 || !l2->vlan) {
+            return;
+        }
+        auto const ipv4 = PacketLogic::source_ipv4(header, data, *l2);
+        for (auto& t : vlans) {
+            if (ipv4 && t.vlan == *l2->vlan && t.first <= *ipv4 && *ipv4 < t.end) {
+                t.answered[*ipv4 - t.first] = true;
+            }
+        }
+    };
+
+    for (auto attempt = 0; attempt <= o.retries; attempt++) {
+        for (auto& t : vlans) {
+            TargetRange targets(t.first, t.end, &exclude);
+            paced_sweep(targets, [&](uint32_t addr) {
+                if (t.answered[addr - t.first]) {
+                    return false;
+                }
+                sweep.arp(addr, t.vlan);
+                return true;
+            }, captureLogic, handler);
+        }
+        collect(captureLogic, handler, ch::steady_clock::now() + linger);
+    }
+}
+
+/// A subnet attached to an interface
+struct Subnet {
+    std::string device;
+    int ifindex;
+    uint32_t first; //!< host order
+    uint32_t end;   //!< address after the last, also the broadcast address (host order)
 };
 
+/// Find the IPv4 subnets on the up, non-loopback Ethernet interfaces
+/// @param device only consider this interface, or every one when empty
+/// @param min_prefix shortest prefix length to accept, so that a VPN's /8
+/// is not swept by accident; larger subnets are skipped with a warning
+/// @exception std::runtime\_error when no subnet qualifies
+auto attached_subnets(std::string const& device, int min_prefix) -> std::vector<Subnet> {
+    std::vector<Subnet> result;
+    for (auto const& a : InterfaceAddresses()) {
+        auto const prefix = std::popcount(a.netmask);
+        if (!(a.flags & IFF_UP) || a.flags & (IFF_LOOPBACK | IFF_POINTOPOINT) || 0 == a.mac
+         || (!device.empty() && device != a.device) || prefix > 30) {
+            continue;
+        }
+
+        auto const network = a.ipv4 & a.netmask;
+        if (prefix < min_prefix) {
+            std::cerr << fmt::format("Skipping {}.{}.{}.{}/{} on {}: larger than /{}",
+                network >> 24, network >> 16 & 0xff, network >> 8 & 0xff, network & 0xff,
+                prefix, a.device, min_prefix) << std::endl;
+            continue;
+        }
+
+        Subnet subnet {a.device, static_cast<int>(if_nametoindex(a.device.c_str())), network + 1, network | ~a.netmask};
+        auto const same = [&](Subnet const& s) {
+            return s.device == subnet.device && s.first == subnet.first && s.end == subnet.end;
+        };
+        // Interfaces with several addresses in one subnet list it repeatedly
+        if (std::none_of(result.begin(), result.end(), same)) {
+            result.push_back(std::move(subnet));
+        }
+    }
+
+    if (result.empty()) {
+        throw std::runtime_error("no attached subnets to scan");
+    }
+    std::sort(result.begin(), result.end(), [](Subnet const& x, Subnet const& y) { return x.first < y.first; });
+    return result;
+}
+
+/// Scan shards assigned by a coordinator, serving one coordinator at a time
+/// @param o command line options
+/// @param pcap reply listener
+/// @param exclude addresses never to probe, whatever the coordinator asks
+/// @param dumper savefile for every accepted reply, if any
+auto serve_worker(options const& o, Pcap& pcap, ExclusionSet const& exclude, PcapDumper* dumper) -> void {
+    auto listener = ListenEndpoint(o.listen);
+
+    SpawnLogic spawnLogic;
+    CaptureLogic captureLogic(pcap, o.capture_cpus);
+    SteadyClock clock;
+
+    std::optional<Rtnetlink> rtnetlink;
+    if (o.neighbours) {
+        rtnetlink.emplace();
+    }
+    auto const ifindex = static_cast<int>(if_nametoindex(o.device.c_str()));
+
+    for (;;) {
+        auto fd = Accept(listener);
+        try {
+            PacketLogic packetLogic(nullptr, [fd](ResultRecord const& r) {
+                SendResult(fd, r);
+            }, false);
+            if (dumper) {
+                packetLogic.audit([dumper](pcap_pkthdr const* header, u_char const* data) {
+                    dumper->dump(header, data);
+                });
+            }
+
+            ServeShards(fd, [&](Shard const& shard) {
+                ScanLoop scanLoop(spawnLogic, captureLogic, clock, o.spawn_limit, o.retries);
+                if (dumper) {
+                    scanLoop.every(1s, [dumper] { dumper->flush(); });
+                }
+                TargetRange targets(shard.first, shard.end, &exclude);
+                scanLoop.run(targets, packetLogic);
+                // Workers idle between shards; leave nothing buffered
+                if (dumper) {
+                    dumper->flush();
+                }
+
+                if (rtnetlink) {
+                    for (auto const& n : rtnetlink->neighbours()) {
+                        if (ifindex == n.ifindex && shard.first <= n.ipv4 && n.ipv4 < shard.end) {
+                            packetLogic.neighbour(n.mac, n.ipv4);
+                        }
+                    }
+                }
+            });
+        } catch (std::system_error const& e) {
+            std::cerr << "Coordinator lost: " << e.what() << std::endl;
+        }
+        Close(fd);
+    }
+}
+
 } // namespace
 
 /// Main function
@@ -208,35 +677,265 @@ auto main(int argc, char** argv) -> int
 {
     try {
         auto options = get_options(argc, argv);
-        auto pcap = pcap_setup(options.device);
-        set_cloexec(pcap.fileno());
 
-        auto addr = ntohl(options.network.value) + 1;
-        auto end = ntohl(options.network.value | ~options.netmask.value);
-        auto kids = 0;
+        if (options.profile) {
+            Profile::enable();
+        }
+
+        std::optional<OuiTable> oui;
+        if (!options.oui.empty()) {
+            oui = OuiTable::open(options.oui.c_str());
+        }
+
+        std::optional<ResultRing> ring;
+        if (!options.ring.empty()) {
+            ring = ResultRing::create(options.ring.c_str(), options.ring_size);
+        }
+
+        // Names are only ever printed, so quiet scans skip the lookups
+        std::optional<ReverseDns> resolver;
+        if (options.resolve && !options.quiet) {
+            resolver.emplace(ReverseDns::server(options.dns_server));
+        }
+
+        // With a resolver, hosts are printed once their lookup finishes
+        auto const vendors = oui ? &*oui : nullptr;
+        auto resolved = [&] {
+            for (auto const& answer : resolver->poll()) {
+                PacketLogic::print(vendors, answer.record, answer.name);
+            }
+        };
+        // Every lookup times out eventually
+        auto finish_lookups = [&] {
+            while (resolver && 0 < resolver->outstanding()) {
+                for (auto const& answer : resolver->wait()) {
+                    PacketLogic::print(vendors, answer.record, answer.name);
+                }
+            }
+        };
+
+        std::function<void(ResultRecord const&)> sink;
+        if (ring || resolver) {
+            sink = [&](ResultRecord const& r) {
+                if (ring) {
+                    ring->push(r);
+                }
+                if (resolver && r.flags & ResultRecord::has_ipv4) {
+                    resolver->lookup(r);
+                } else if (resolver) {
+                    PacketLogic::print(vendors, r, "");
+                }
+            };
+        }
+
+        PacketLogic packetLogic(vendors, std::move(sink), !options.quiet && !resolver);
+
+        ExclusionSet exclude;
+        for (auto const& cidr : options.excludes) {
+            exclude.add(cidr);
+        }
+        for (auto const& path : options.exclude_files) {
+            exclude.load(path.c_str());
+        }
+        exclude.finalize();
+
+        if (options.coordinate) {
+            Coordinator coordinator(options.workers);
+            if (resolver) {
+                coordinator.every(50ms, resolved);
+            }
+            coordinator.run(SplitTargets(options.targets, options.shard_prefix, &exclude), [&](ResultRecord const& r) {
+                packetLogic.merge(r);
+            });
+            finish_lookups();
+            Profile::report(std::cerr);
+            return 0;
+        }
+
+        // One capture per device; every subnet on a device shares it
+        std::vector<Subnet> plan;
+        std::vector<Pcap> pcaps;
+        if (options.auto_scan) {
+            plan = attached_subnets(options.device, options.auto_prefix);
+            for (auto i = plan.begin(); i != plan.end(); i++) {
+                auto const opened = [&](Subnet const& s) { return s.device == i->device; };
+                if (std::none_of(plan.begin(), i, opened)) {
+                    pcaps.push_back(pcap_setup(i->device, false, options.presweep, false));
+                }
+            }
+        } else {
+            pcaps.push_back(pcap_setup(options.device, options.passive, options.presweep, !options.vlans.empty()));
+        }
+        for (auto& p : pcaps) {
+            set_cloexec(p.fileno());
+        }
+        auto& pcap = pcaps.front();
+
+        // Buffered; busy captures flush themselves each second and the
+        // loops below flush quiet ones, bounding what a kill loses
+        std::optional<PcapDumper> dumper;
+        auto flush_at = ch::steady_clock::now();
+        auto flush = [&] {
+            if (dumper) {
+                dumper->flush();
+                flush_at = ch::steady_clock::now() + 1s;
+            }
+        };
+        if (!options.write_pcap.empty()) {
+            dumper.emplace(pcap, options.write_pcap, options.pcap_rotate << 20);
+            packetLogic.audit([&](pcap_pkthdr const* header, u_char const* data) {
+                dumper->dump(header, data);
+            });
+        }
+
+        if (options.passive) {
+            packetLogic.per_address(true);
+            CaptureLogic captureLogic(pcap, options.capture_cpus);
+            for (;;) {
+                std::optional<ch::steady_clock::time_point> deadline;
+                if (resolver) {
+                    deadline = ch::steady_clock::now() + 50ms;
+                } else if (dumper) {
+                    deadline = flush_at;
+                }
+                if (0 < captureLogic.wait(deadline)) {
+                    captureLogic.dispatch(packetLogic);
+                }
+                if (resolver) {
+                    resolved();
+                }
+                if (dumper && flush_at <= ch::steady_clock::now()) {
+                    flush();
+                }
+            }
+        }
+
+        if (!options.auto_scan && !options.worker && options.vlans.empty()) {
+            plan.push_back({options.device, static_cast<int>(if_nametoindex(options.device.c_str())),
+                            ntohl(options.network.value) + 1, ntohl(options.network.value | ~options.netmask.value)});
+        }
+
+        // Subnets are sorted by first address; clip any overlap so that no
+        // address is probed twice
+        uint32_t covered = 0;
+        for (auto& s : plan) {
+            s.first = std::max(s.first, covered);
+            covered = std::max(covered, s.end);
+        }
+
+        if (options.worker) {
+            serve_worker(options, pcap, exclude, dumper ? &*dumper : nullptr);
+            return 0;
+        }
+
+        if (!options.vlans.empty()) {
+            CaptureLogic captureLogic(pcap, options.capture_cpus);
+            scan_vlans(options, exclude, captureLogic, packetLogic);
+            finish_lookups();
+            Profile::report(std::cerr);
+            return 0;
+        }
+
+        // The checkpoint describes the hull of the subnets
+        auto const first = plan.front().first;
+        auto const end = covered;
+        auto addr = first;
+        std::vector<uint32_t> pending;
+
+        // Hosts reported before the interruption are not repeated
+        if (options.resume) {
+            auto checkpoint = Checkpoint::load(options.checkpoint.c_str());
+            if (first != checkpoint.first || end != checkpoint.end) {
+                throw std::runtime_error("checkpoint is for a different network");
+            }
+            addr = checkpoint.cursor;
+            for (auto a : checkpoint.outstanding) {
+                if (!exclude.contains(a)) {
+                    pending.push_back(a);
+                }
+            }
+            for (auto mac : checkpoint.macs) {
+                packetLogic.seen(mac);
+            }
+        }
+
+        std::vector<Pcap*> devices;
+        for (auto& p : pcaps) {
+            devices.push_back(&p);
+        }
 
-        PacketLogic packetLogic;
         SpawnLogic spawnLogic;
-        SelectLogic selectLogic(pcap.selectable_fd());
+        CaptureLogic captureLogic(devices, options.capture_cpus);
+        SteadyClock clock;
+
+        ScanLoop scanLoop(spawnLogic, captureLogic, clock, options.spawn_limit, options.retries);
+
+        if (!options.checkpoint.empty()) {
+            scanLoop.checkpoint(ch::seconds{options.checkpoint_interval}, [&](uint32_t cursor, std::vector<uint32_t> const& outstanding) {
+                Checkpoint checkpoint {first, end, cursor, outstanding, {}};
+                checkpoint.macs.reserve(packetLogic.found());
+                packetLogic.macs().for_each([&](uint64_t mac) { checkpoint.macs.push_back(mac); });
+                checkpoint.save(options.checkpoint.c_str());
+            });
+        }
+
+        // The kernel resolves each live host's MAC for ping anyway; collect
+        // those entries in one netlink dump rather than per packet.
+        std::optional<Rtnetlink> rtnetlink;
+        auto harvest = [&] {
+            for (auto const& n : rtnetlink->neighbours()) {
+                for (auto const& s : plan) {
+                    if (s.ifindex == n.ifindex && s.first <= n.ipv4 && n.ipv4 < s.end) {
+                        packetLogic.neighbour(n.mac, n.ipv4);
+                        break;
+                    }
+                }
+            }
+        };
+        if (options.neighbours) {
+            rtnetlink.emplace();
+            scanLoop.every(1s, harvest);
+        }
+
+        if (resolver) {
+            scanLoop.every(50ms, resolved);
+        }
+
+        if (dumper) {
+            scanLoop.every(1s, flush);
+        }
 
-        for(;;) {
-            while (kids < options.spawn_limit && addr < end) {
-                spawnLogic.spawn(addr);
-                kids++;
-                addr++;
+        // Hosts that answered the sweep need no ping
+        std::optional<ExclusionSet> silent;
+        if (options.presweep) {
+            for (auto const& s : plan) {
+                if (addr < s.end) {
+                    silent = presweep(s.device, std::max(addr, s.first), s.end, silent ? *silent : exclude, captureLogic, packetLogic);
+                }
             }
+        }
 
-            auto events = selectLogic.wait(kids);
-            switch (events) {
-            case -1:
-                while (kids && Wait(-1, WNOHANG).first) { kids--; }
-                break;
-            case 0:
-                return 0;
-            case 1:
-                pcap.dispatch(0, packetLogic);
+        // One range per subnet, taken in turn under the one spawn limit
+        std::vector<TargetRange> ranges;
+        for (auto const& s : plan) {
+            if (addr < s.end) {
+                ranges.emplace_back(std::max(addr, s.first), s.end, silent ? &*silent : &exclude);
             }
         }
+        InterleavedTargets targets(std::move(ranges));
+        scanLoop.run(targets, packetLogic, std::move(pending));
+
+        // A finished scan has nothing left to resume
+        if (!options.checkpoint.empty()) {
+            Checkpoint::discard(options.checkpoint.c_str());
+        }
+
+        if (rtnetlink) {
+            harvest();
+        }
+        finish_lookups();
+        Profile::report(std::cerr);
+        return 0;
 
     } catch (std::exception const& e) {
         std::cerr << "Failure: " << e.what() << std::endl;
@@ -0,0 +1,143 @@
+//
+//  oui_main.cpp
+//  netscan
+//
+//  Builds the vendor table used by netscan --oui from the IEEE registry
+//  CSV files (oui.csv, mam.csv, oui36.csv).
+//
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "OuiTable.hpp"
+
+namespace {
+
+struct options {
+    std::string output;
+    std::vector<std::string> inputs;
+};
+
+auto get_options(int argc, char** argv) -> options {
+    namespace po = boost::program_options;
+    options o;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "produce help message")
+        ("output,o", po::value(&o.output)->required(), "table file to write")
+        ("input", po::value(&o.inputs)->required(), "IEEE registry CSV files");
+
+    po::positional_options_description p;
+    p.add("input", -1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    po::notify(vm);
+
+    return o;
+}
+
+auto trim(std::string s) -> std::string {
+    auto const ws = " \t\r\n";
+    auto const first = s.find_first_not_of(ws);
+    if (std::string::npos == first) {
+        return {};
+    }
+    return s.substr(first, s.find_last_not_of(ws) - first + 1);
+}
+
+/// Split CSV text into records of fields, honoring quoted fields
+auto parse_csv(std::string const& text) -> std::vector<std::vector<std::string>> {
+    std::vector<std::vector<std::string>> records;
+    std::vector<std::string> record;
+    std::string field;
+    auto quoted = false;
+
+    for (std::size_t i = 0; i < text.size(); i++) {
+        auto c = text[i];
+        if (quoted) {
+            if ('"' != c) {
+                field += c;
+            } else if (i + 1 < text.size() && '"' == text[i+1]) {
+                field += '"';
+                i++;
+            } else {
+                quoted = false;
+            }
+        } else if ('"' == c) {
+            quoted = true;
+        } else if (',' == c) {
+            record.push_back(std::move(field));
+            field.clear();
+        } else if ('\n' == c) {
+            record.push_back(std::move(field));
+            field.clear();
+            records.push_back(std::move(record));
+            record.clear();
+        } else if ('\r' != c) {
+            field += c;
+        }
+    }
+    if (!field.empty() || !record.empty()) {
+        record.push_back(std::move(field));
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+/// Read the Assignment and Organization Name columns of a registry file
+auto load(std::string const& path, std::vector<OuiTable::Assignment>& out) -> void {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("unable to open " + path);
+    }
+    std::string text {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    auto records = parse_csv(text);
+    for (std::size_t i = 1; i < records.size(); i++) { // skip header row
+        auto const& r = records[i];
+        if (r.size() < 3) {
+            continue;
+        }
+        auto const hex = trim(r[1]);
+        std::size_t used;
+        auto const prefix = std::stoull(hex, &used, 16);
+        if (used != hex.size() || hex.empty() || 12 < hex.size()) {
+            throw std::runtime_error(path + ": bad assignment " + hex);
+        }
+        out.push_back({prefix, static_cast<int>(4 * hex.size()), trim(r[2])});
+    }
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    try {
+        auto options = get_options(argc, argv);
+        std::vector<OuiTable::Assignment> assignments;
+        for (auto const& input : options.inputs) {
+            load(input, assignments);
+        }
+        auto n = assignments.size();
+        OuiTable::write(options.output.c_str(), std::move(assignments));
+        std::cerr << n << " assignments written" << std::endl;
+    } catch (std::exception const& e) {
+        std::cerr << "Failure: " << e.what() << std::endl;
+        return 1;
+    }
+}
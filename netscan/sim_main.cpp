@@ -0,0 +1,223 @@
+//
+//  sim_main.cpp
+//  netscan
+//
+//  Runs the production scan loop against a simulated network so that
+//  end-to-end behavior can be measured at scale without root or a LAN.
+//
+
+#include <unistd.h>
+
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+
+#include "Cluster.hpp"
+#include "ExclusionSet.hpp"
+#include "Ipv4Argument.hpp"
+#include "MyLibC.hpp"
+#include "PacketLogic.hpp"
+#include "ScanLoop.hpp"
+#include "SimNetwork.hpp"
+#include "Trace.hpp"
+
+namespace ch = std::chrono;
+
+namespace {
+
+struct options {
+    int spawn_limit;
+    int retries;
+    ipv4_argument network;
+    ipv4_argument netmask;
+    double latency_ms;
+    double jitter_ms;
+    SimNetwork::Config config;
+    std::vector<std::string> excludes;
+    bool profile;
+    int workers;
+    int shard_prefix;
+    bool lose_worker;
+    bool expect_all;
+};
+
+auto get_options(int argc, char** argv) -> options {
+    namespace po = boost::program_options;
+    options o;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "produce help message")
+        ("limit,l", po::value(&o.spawn_limit)->default_value(50), "concurrent probe limit")
+        ("retries,r", po::value(&o.retries)->default_value(0), "additional probes for unresponsive addresses")
+        ("network", po::value(&o.network)->required(), "network number")
+        ("netmask", po::value(&o.netmask)->required(), "network mask")
+        ("live", po::value(&o.config.live)->default_value(0.5), "fraction of addresses that answer")
+        ("loss", po::value(&o.config.loss)->default_value(0.01), "probability a probe is lost")
+        ("latency", po::value(&o.latency_ms)->default_value(0.5), "minimum round trip in milliseconds")
+        ("jitter", po::value(&o.jitter_ms)->default_value(2.0), "mean additional delay in milliseconds")
+        ("seed", po::value(&o.config.seed)->default_value(0), "simulation random seed")
+        ("exclude", po::value(&o.excludes)->composing(), "address or CIDR block never to probe")
+        ("profile", po::bool_switch(&o.profile), "print a breakdown of time spent per scan phase")
+        ("workers", po::value(&o.workers)->default_value(0), "coordinate this many local worker processes over unix sockets, 0 for none")
+        ("shard-prefix", po::value(&o.shard_prefix)->default_value(26), "prefix length of each distributed shard")
+        ("lose-worker", po::bool_switch(&o.lose_worker), "make the first worker exit while holding its first shard")
+        ("expect-all", po::bool_switch(&o.expect_all), "fail unless exactly the live hosts are found (use with --loss 0)");
+
+    po::positional_options_description p;
+    p.add("network", 1).add("netmask", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    po::notify(vm);
+
+    o.config.latency = ch::microseconds{static_cast<long>(o.latency_ms * 1000)};
+    o.config.jitter = ch::microseconds{static_cast<long>(o.jitter_ms * 1000)};
+    return o;
+}
+
+/// Serve one coordinator connection from a forked worker. Workers apply
+/// no exclusions of their own, so excluded hosts are only skipped if the
+/// coordinator left them out of the shards.
+/// @param listener socket to accept the coordinator on
+/// @param o command line options
+/// @param lose exit without reply on the first shard, as a crashed worker
+auto serve_worker(int listener, options const& o, bool lose) -> void {
+    auto fd = Accept(listener);
+
+    SimClock clock;
+    SimNetwork network(clock, o.config);
+    PacketLogic packetLogic(nullptr, [fd](ResultRecord const& r) {
+        SendResult(fd, r);
+    }, false);
+
+    ServeShards(fd, [&](Shard const& shard) {
+        if (lose) {
+            _exit(EXIT_SUCCESS);
+        }
+        ScanLoop scanLoop(network, network, clock, o.spawn_limit, o.retries);
+        TargetRange targets(shard.first, shard.end);
+        scanLoop.run(targets, packetLogic);
+    });
+}
+
+/// Distribute the network to local worker processes and merge their results
+/// @param o command line options
+/// @param exclude addresses the coordinator must leave out of the shards
+/// @param packetLogic reports merged results
+auto coordinate(options const& o, ExclusionSet const& exclude, PacketLogic& packetLogic) -> void {
+    std::vector<std::string> endpoints;
+    std::vector<int> listeners;
+    for (auto i = 0; i < o.workers; i++) {
+        endpoints.push_back("unix:/tmp/netscan-sim." + std::to_string(getpid()) + "." + std::to_string(i));
+        unlink(endpoints.back().c_str() + 5);
+        listeners.push_back(ListenEndpoint(endpoints.back()));
+    }
+
+    // Nothing buffered may be written twice by the children
+    std::cout.flush();
+    std::vector<pid_t> children;
+    for (auto i = 0; i < o.workers; i++) {
+        auto pid = Fork();
+        if (0 == pid) {
+            auto status = EXIT_SUCCESS;
+            try {
+                serve_worker(listeners[i], o, o.lose_worker && 0 == i);
+            } catch (std::exception const& e) {
+                std::cerr << "Worker failure: " << e.what() << std::endl;
+                status = EXIT_FAILURE;
+            }
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+    for (auto fd : listeners) {
+        Close(fd);
+    }
+
+    auto const network = ntohl(o.network.value);
+    auto const target = fmt::format("{}.{}.{}.{}/{}",
+        network >> 24, network >> 16 & 0xff, network >> 8 & 0xff, network & 0xff,
+        std::popcount(ntohl(o.netmask.value)));
+    {
+        Coordinator coordinator(endpoints);
+        for (auto const& endpoint : endpoints) {
+            unlink(endpoint.c_str() + 5);
+        }
+        coordinator.run(SplitTargets({target}, o.shard_prefix, &exclude), [&](ResultRecord const& r) {
+            packetLogic.merge(r);
+        });
+    }
+    for (auto pid : children) {
+        Wait(pid);
+    }
+}
+
+} // namespace
+
+/// Simulated scan: hosts go to stdout as with netscan, a summary to stderr
+auto main(int argc, char** argv) -> int
+{
+    try {
+        auto options = get_options(argc, argv);
+
+        auto addr = ntohl(options.network.value) + 1;
+        auto end = ntohl(options.network.value | ~options.netmask.value);
+
+        ExclusionSet exclude;
+        for (auto const& cidr : options.excludes) {
+            exclude.add(cidr);
+        }
+        exclude.finalize();
+
+        uint64_t live = 0;
+        SimClock clock;
+        SimNetwork network(clock, options.config);
+        for (auto a = addr; a < end; a++) {
+            live += !exclude.contains(a) && network.live(a);
+        }
+
+        if (options.profile) {
+            Profile::enable();
+        }
+
+        PacketLogic packetLogic;
+        ScanLoop scanLoop(network, network, clock, options.spawn_limit, options.retries);
+
+        auto started = ch::steady_clock::now();
+        if (0 < options.workers) {
+            coordinate(options, exclude, packetLogic);
+        } else {
+            TargetRange targets(addr, end, &exclude);
+            scanLoop.run(targets, packetLogic);
+        }
+        auto wall = ch::duration<double>(ch::steady_clock::now() - started);
+
+        auto stats = network.stats();
+        std::cerr << "probes:    " << stats.probes << '\n'
+                  << "replies:   " << stats.replies << '\n'
+                  << "found:     " << packetLogic.found() << " of " << live << " live\n"
+                  << "simulated: " << ch::duration<double>(clock.now().time_since_epoch()).count() << "s\n"
+                  << "wall:      " << wall.count() << "s" << std::endl;
+        Profile::report(std::cerr);
+
+        if (options.expect_all && packetLogic.found() != live) {
+            return 1;
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Failure: " << e.what() << std::endl;
+        return 1;
+    }
+}
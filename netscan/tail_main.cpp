@@ -0,0 +1,111 @@
+//
+//  tail_main.cpp
+//  netscan
+//
+//  Prints the records published to a netscan result ring.
+//
+
+#include <arpa/inet.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+
+#include "ResultRing.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct options {
+    std::string ring;
+    bool follow;
+};
+
+auto get_options(int argc, char** argv) -> options {
+    namespace po = boost::program_options;
+    options o;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "produce help message")
+        ("ring", po::value(&o.ring)->required(), "result ring file")
+        ("follow,f", po::bool_switch(&o.follow), "wait for new records");
+
+    po::positional_options_description p;
+    p.add("ring", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    po::notify(vm);
+
+    return o;
+}
+
+auto print(ResultRecord const& r) -> void {
+    std::cout << fmt::format("{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}",
+        r.mac >> 40 & 0xff, r.mac >> 32 & 0xff, r.mac >> 24 & 0xff,
+        r.mac >> 16 & 0xff, r.mac >>  8 & 0xff, r.mac       & 0xff);
+
+    if (r.flags & ResultRecord::has_ipv4) {
+        std::cout << fmt::format("\t{}.{}.{}.{}", r.ipv4 >> 24, r.ipv4 >> 16 & 0xff, r.ipv4 >> 8 & 0xff, r.ipv4 & 0xff);
+    } else {
+        std::cout << "\t-";
+    }
+
+    if (r.flags & ResultRecord::has_rtt) {
+        std::cout << fmt::format("\t{:.3f}ms", r.rtt_us / 1000.0);
+    } else {
+        std::cout << "\t-";
+    }
+
+    std::cout << fmt::format("\t{}.{:09}", r.timestamp_ns / 1'000'000'000, r.timestamp_ns % 1'000'000'000);
+
+    if (r.flags & ResultRecord::has_vlan) {
+        std::cout << fmt::format("\tvlan {}", r.vlan);
+    }
+    std::cout << '\n';
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    try {
+        auto options = get_options(argc, argv);
+        auto reader = ResultRingReader::open(options.ring.c_str());
+
+        for (;;) {
+            bool any = false;
+            auto lost = reader.poll([&](ResultRecord const& r) {
+                any = true;
+                print(r);
+            });
+            if (lost) {
+                std::cerr << lost << " records lost" << std::endl;
+            }
+            std::cout.flush();
+            if (!options.follow) {
+                return 0;
+            }
+            // Readers never touch the producer; an idle ring is simply polled
+            if (!any) {
+                std::this_thread::sleep_for(10ms);
+            }
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Failure: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,381 @@
+//
+//  test_main.cpp
+//  netscan
+//
+//  Checks of the decoders and protocol code that need neither privileges
+//  nor a network: each builds a canned input and compares what is parsed.
+//
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "Cluster.hpp"
+#include "MyLibC.hpp"
+#include "PacketLogic.hpp"
+#include "ReverseDns.hpp"
+#include "Rtnetlink.hpp"
+#include "TargetRange.hpp"
+
+#ifdef __linux__
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+namespace {
+
+auto failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+auto check(bool ok, char const* what, int line) -> void {
+    if (!ok) {
+        fmt::print(stderr, "test_main.cpp:{}: failed: {}\n", line, what);
+        failures++;
+    }
+}
+
+#ifdef __linux__
+
+/// Builds a netlink datagram the way the kernel lays it out
+class NetlinkBuffer {
+    std::vector<unsigned char> bytes_;
+    std::size_t message_ = 0;
+    std::size_t attribute_ = 0;
+
+    auto append(void const* data, std::size_t len) -> void {
+        auto p = static_cast<unsigned char const*>(data);
+        bytes_.insert(bytes_.end(), p, p + len);
+    }
+
+    auto pad() -> void {
+        bytes_.resize(NLMSG_ALIGN(bytes_.size()));
+    }
+
+    auto header() -> nlmsghdr* {
+        return reinterpret_cast<nlmsghdr*>(bytes_.data() + message_);
+    }
+
+public:
+    auto message(uint16_t type, uint32_t seq) -> NetlinkBuffer& {
+        pad();
+        message_ = bytes_.size();
+        nlmsghdr h {};
+        h.nlmsg_len = NLMSG_HDRLEN;
+        h.nlmsg_type = type;
+        h.nlmsg_seq = seq;
+        append(&h, sizeof h);
+        bytes_.resize(message_ + NLMSG_HDRLEN);
+        return *this;
+    }
+
+    auto neighbour(int ifindex, uint16_t state) -> NetlinkBuffer& {
+        ndmsg nd {};
+        nd.ndm_family = AF_INET;
+        nd.ndm_ifindex = ifindex;
+        nd.ndm_state = state;
+        return body(&nd, sizeof nd);
+    }
+
+    auto body(void const* data, std::size_t len) -> NetlinkBuffer& {
+        append(data, len);
+        pad();
+        header()->nlmsg_len = static_cast<uint32_t>(bytes_.size() - message_);
+        return *this;
+    }
+
+    auto attribute(uint16_t type, std::vector<unsigned char> const& payload) -> NetlinkBuffer& {
+        attribute_ = bytes_.size();
+        rtattr a {};
+        a.rta_type = type;
+        a.rta_len = static_cast<uint16_t>(RTA_LENGTH(payload.size()));
+        append(&a, sizeof a);
+        bytes_.resize(bytes_.size() + (RTA_ALIGN(sizeof a) - sizeof a));
+        return body(payload.data(), payload.size());
+    }
+
+    /// Make the last attribute claim more bytes than its message holds
+    auto overrun() -> NetlinkBuffer& {
+        auto a = reinterpret_cast<rtattr*>(bytes_.data() + attribute_);
+        a->rta_len = static_cast<uint16_t>(a->rta_len + 16);
+        return *this;
+    }
+
+    auto data() const -> void const* { return bytes_.data(); }
+    auto size() const -> std::size_t { return bytes_.size(); }
+};
+
+auto test_neighbours() -> void {
+    std::vector<unsigned char> const ip1 {10, 0, 0, 1}, ip2 {10, 0, 0, 2}, ip3 {10, 0, 0, 3};
+    std::vector<unsigned char> const ethernet {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+    std::vector<unsigned char> const infiniband(20, 0xab);
+
+    NetlinkBuffer dump;
+    dump.message(RTM_NEWNEIGH, 7).neighbour(2, NUD_REACHABLE)
+        .attribute(NDA_DST, ip1).attribute(NDA_LLADDR, ethernet);
+    // Non-Ethernet link-layer address
+    dump.message(RTM_NEWNEIGH, 7).neighbour(3, NUD_STALE)
+        .attribute(NDA_DST, ip2).attribute(NDA_LLADDR, infiniband);
+    // Resolution failed
+    dump.message(RTM_NEWNEIGH, 7).neighbour(2, NUD_FAILED)
+        .attribute(NDA_DST, ip3).attribute(NDA_LLADDR, ethernet);
+    // Attribute runs past the end of its message
+    dump.message(RTM_NEWNEIGH, 7).neighbour(2, NUD_PERMANENT)
+        .attribute(NDA_DST, ip3).attribute(NDA_LLADDR, ethernet).overrun();
+    // Reply to another request
+    dump.message(RTM_NEWNEIGH, 6).neighbour(2, NUD_REACHABLE)
+        .attribute(NDA_DST, ip2).attribute(NDA_LLADDR, ethernet);
+
+    std::vector<Neighbour> result;
+    CHECK(!ParseNeighbours(dump.data(), dump.size(), 7, result));
+    CHECK(1 == result.size());
+    if (1 == result.size()) {
+        CHECK(2 == result[0].ifindex);
+        CHECK(0x0a000001 == result[0].ipv4);
+        CHECK(0x021122334455 == result[0].mac);
+    }
+
+    // A datagram cut short inside a message yields nothing from it
+    NetlinkBuffer whole;
+    whole.message(RTM_NEWNEIGH, 7).neighbour(2, NUD_REACHABLE)
+        .attribute(NDA_DST, ip2).attribute(NDA_LLADDR, ethernet);
+    result.clear();
+    CHECK(!ParseNeighbours(whole.data(), whole.size() - 4, 7, result));
+    CHECK(result.empty());
+
+    NetlinkBuffer done;
+    done.message(NLMSG_DONE, 7).body("\0\0\0\0", 4);
+    CHECK(ParseNeighbours(done.data(), done.size(), 7, result));
+
+    nlmsgerr err {};
+    err.error = -EPERM;
+    NetlinkBuffer error;
+    error.message(NLMSG_ERROR, 7).body(&err, sizeof err);
+    try {
+        ParseNeighbours(error.data(), error.size(), 7, result);
+        CHECK(!"NLMSG_ERROR accepted");
+    } catch (std::system_error const& e) {
+        CHECK(EPERM == e.code().value());
+    }
+}
+
+#endif
+
+auto test_neighbour_merge() -> void {
+    std::vector<ResultRecord> reported;
+    PacketLogic packetLogic(nullptr, [&](ResultRecord const& r) { reported.push_back(r); }, false);
+
+    packetLogic.neighbour(0x020000000001, 0x0a000001);
+    packetLogic.neighbour(0x020000000001, 0x0a000001);
+    CHECK(1 == reported.size());
+    if (!reported.empty()) {
+        CHECK(0x020000000001 == reported[0].mac);
+        CHECK(0x0a000001 == reported[0].ipv4);
+        CHECK(0 != (reported[0].flags & ResultRecord::has_ipv4));
+    }
+
+    // A captured reply from a MAC already taken from the table is not new
+    u_char frame[] {
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x09,
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x08, 0x00,
+        0x45, 0x00};
+    pcap_pkthdr header {};
+    header.caplen = header.len = sizeof frame;
+    packetLogic(&header, frame);
+    CHECK(1 == reported.size());
+
+    frame[11] = 0x02;
+    packetLogic(&header, frame);
+    CHECK(2 == reported.size());
+    CHECK(2 == packetLogic.found());
+}
+
+auto test_interleaved_targets() -> void {
+    // Two /29 interiors and an empty range, as main builds them per subnet
+    std::vector<TargetRange> ranges;
+    ranges.emplace_back(0x0a000001, 0x0a000007);
+    ranges.emplace_back(0x0a000101, 0x0a000104);
+    ranges.emplace_back(0x0a000200, 0x0a000200);
+    InterleavedTargets targets(std::move(ranges));
+
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> cursors;
+    while (!targets.empty()) {
+        cursors.push_back(targets.cursor());
+        order.push_back(targets.pop());
+    }
+    std::vector<uint32_t> const expected {
+        0x0a000001, 0x0a000101, 0x0a000002, 0x0a000102, 0x0a000003, 0x0a000103,
+        0x0a000004, 0x0a000005, 0x0a000006};
+    CHECK(expected == order);
+
+    // Resuming from the cursor never skips an address not yet taken
+    for (std::size_t i = 0; i < order.size(); i++) {
+        for (auto j = i; j < order.size(); j++) {
+            CHECK(cursors[i] <= order[j]);
+        }
+    }
+    CHECK(0x0a000200 == targets.cursor());
+}
+
+/// Builds a DNS response to the PTR query for 10.0.0.1
+class DnsResponse {
+    std::vector<unsigned char> bytes_;
+
+    auto put16(unsigned n) -> void {
+        bytes_.push_back(static_cast<unsigned char>(n >> 8));
+        bytes_.push_back(static_cast<unsigned char>(n));
+    }
+
+    auto put_name(std::vector<std::string> const& labels) -> void {
+        for (auto const& label : labels) {
+            bytes_.push_back(static_cast<unsigned char>(label.size()));
+            bytes_.insert(bytes_.end(), label.begin(), label.end());
+        }
+        bytes_.push_back(0);
+    }
+
+public:
+    DnsResponse() {
+        put16(0x1234);
+        put16(0x8180);
+        put16(1);
+        put16(0);
+        put16(0);
+        put16(0);
+        put_name({"1", "0", "0", "10", "in-addr", "arpa"});
+        put16(12);
+        put16(1);
+    }
+
+    auto ptr(std::vector<std::string> const& labels) -> DnsResponse& {
+        bytes_[7]++;
+        put16(0xc00c);
+        put16(12);
+        put16(1);
+        put16(0);
+        put16(300);
+        auto const length = bytes_.size();
+        put16(0);
+        put_name(labels);
+        auto const rdlength = bytes_.size() - length - 2;
+        bytes_[length] = static_cast<unsigned char>(rdlength >> 8);
+        bytes_[length + 1] = static_cast<unsigned char>(rdlength);
+        return *this;
+    }
+
+    auto decode() const -> std::optional<ReverseDns::Response> {
+        return ReverseDns::decode(bytes_.data(), bytes_.size());
+    }
+};
+
+auto test_ptr_names() -> void {
+    auto plain = DnsResponse().ptr({"host-1", "example", "com"}).decode();
+    CHECK(plain && 0x1234 == plain->id && 0 == plain->rcode);
+    CHECK(plain && "1.0.0.10.in-addr.arpa" == plain->question);
+    CHECK(plain && "host-1.example.com" == plain->name && 300 == plain->ttl);
+
+    // Names that would forge output columns or lines are not used
+    for (auto const& label : {std::string("evil\tcolumn"), std::string("evil\nline"),
+                              std::string("bell\a"), std::string("sp ace"), std::string("\xff")}) {
+        auto forged = DnsResponse().ptr({label, "example", "com"}).decode();
+        CHECK(forged && forged->name.empty());
+    }
+
+    // A usable PTR after an unusable one is still taken
+    auto second = DnsResponse().ptr({"a\tb"}).ptr({"good", "example"}).decode();
+    CHECK(second && "good.example" == second->name);
+}
+
+auto test_cluster_frames() -> void {
+    int fds[2];
+    if (-1 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+        throw std::system_error(errno, std::generic_category(), "socketpair");
+    }
+
+    ClusterFrame frame {};
+    frame.type = ClusterFrame::result;
+    frame.first = 0x0a000001;
+    frame.end = 0x0a000100;
+    frame.record.timestamp_ns = 0x0102030405060708;
+    frame.record.mac = 0x021122334455;
+    frame.record.ipv4 = 0x0a000042;
+    frame.record.rtt_us = 1500;
+    frame.record.flags = ResultRecord::has_ipv4 | ResultRecord::has_vlan;
+    frame.record.vlan = 0x0123;
+    SendFrame(fds[0], frame);
+
+    // Every field travels big-endian, in declaration order
+    unsigned char const expected[ClusterFrame::wire_size] {
+        0, 0, 0, 3,  10, 0, 0, 1,  10, 0, 1, 0,  0, 0, 0, 0,
+        1, 2, 3, 4, 5, 6, 7, 8,
+        0, 0, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55,
+        10, 0, 0, 0x42,  0, 0, 0x05, 0xdc,  0, 0, 0, 5,  0x01, 0x23, 0, 0};
+    unsigned char wire[ClusterFrame::wire_size];
+    CHECK(sizeof wire == ReadAll(fds[1], reinterpret_cast<char*>(wire), sizeof wire));
+    CHECK(0 == std::memcmp(expected, wire, sizeof wire));
+
+    CHECK(sizeof wire == static_cast<std::size_t>(write(fds[1], wire, sizeof wire)));
+    auto back = RecvFrame(fds[0]);
+    CHECK(back && 0 == std::memcmp(&*back, &frame, sizeof frame));
+
+    // The worker loop: a shard is scanned, its results streamed, then acknowledged
+    ClusterFrame shard {};
+    shard.type = ClusterFrame::shard;
+    shard.first = 0x0a000001;
+    shard.end = 0x0a000041;
+    SendFrame(fds[1], shard);
+    ClusterFrame finish {};
+    finish.type = ClusterFrame::finish;
+    SendFrame(fds[1], finish);
+
+    std::vector<Shard> scanned;
+    ServeShards(fds[0], [&](Shard const& s) {
+        scanned.push_back(s);
+        SendResult(fds[0], frame.record);
+    });
+    CHECK(1 == scanned.size() && 0x0a000001 == scanned[0].first && 0x0a000041 == scanned[0].end);
+
+    auto result = RecvFrame(fds[1]);
+    CHECK(result && ClusterFrame::result == result->type && 0x021122334455 == result->record.mac);
+    auto done = RecvFrame(fds[1]);
+    CHECK(done && ClusterFrame::shard_done == done->type && 0x0a000041 == done->end);
+
+    // A coordinator that goes away ends the loop
+    Close(fds[1]);
+    ServeShards(fds[0], [](Shard const&) { CHECK(!"shard after close"); });
+    Close(fds[0]);
+}
+
+}
+
+int main() {
+    try {
+#ifdef __linux__
+        test_neighbours();
+#endif
+        test_neighbour_merge();
+        test_cluster_frames();
+        test_ptr_names();
+        test_interleaved_targets();
+    } catch (std::exception const& e) {
+        std::cerr << "test_main: " << e.what() << std::endl;
+        return 1;
+    }
+    if (failures) {
+        fmt::print(stderr, "{} checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}